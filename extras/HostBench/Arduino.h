@@ -0,0 +1,115 @@
+/*
+ * Stand-in for the Arduino core so the library can be built and
+ * benchmarked on a Linux host, see HostBench.cpp
+ *
+ * Time is simulated: the I2C stand-in advances the clock by the time the
+ * transfers take on the bus, delay() advances it by the requested time
+ * and every call of micros() costs one microsecond so busy waits end.
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// program memory is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define memcpy_P memcpy
+
+// the binary constants used by the library
+#define B0010 2
+#define B0011 3
+#define B00000000 0
+#define B00001111 15
+#define B10101000 168
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) \
+	((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+// simulated time in microseconds
+extern uint32_t hostMicros;
+
+inline uint32_t micros() {
+	return hostMicros++;
+}
+
+inline uint32_t millis() {
+	return hostMicros / 1000;
+}
+
+inline void delay(uint32_t ms) {
+	hostMicros += ms * 1000;
+}
+
+inline void delayMicroseconds(unsigned int us) {
+	hostMicros += us;
+}
+
+// the interrupt pin of the MCP23017 is never active
+inline int digitalRead(uint8_t) {
+	return HIGH;
+}
+
+inline void pinMode(uint8_t, uint8_t) {
+}
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class Print {
+public:
+	virtual ~Print() {
+	}
+	virtual size_t write(uint8_t) = 0;
+	size_t write(const char *str) {
+		return str ? write((const uint8_t *) str, strlen(str)) : 0;
+	}
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		size_t n = 0;
+		while (size--)
+			n += write(*buffer++);
+		return n;
+	}
+	size_t write(const char *buffer, size_t size) {
+		return write((const uint8_t *) buffer, size);
+	}
+	size_t print(const char str[]) {
+		return write(str);
+	}
+	size_t print(char c) {
+		return write((uint8_t) c);
+	}
+	size_t print(const __FlashStringHelper *str) {
+		return write((const char *) str);
+	}
+};
+
+#endif // Arduino_h
@@ -0,0 +1,247 @@
+/*
+ * Host benchmark of the RgbLcdKeyShieldI2C library
+ *
+ * Repeats the measurements of the Speedtest sketches on a Linux host with
+ * a simulated bus at 100 kHz, 400 kHz and 1 MHz. The stand-ins for
+ * Arduino.h and I2C.h advance a simulated clock by the time the STARTs,
+ * addresses and data bytes take on the bus, so the results show the bus
+ * time of the library without the time the processor needs.
+ *
+ * The STARTs and bytes of every operation don't depend on the simulated
+ * time, they are compared with Baseline.txt so a change that sends more
+ * makes the benchmark fail. All headers of the library are built, the
+ * class templates are instantiated completely.
+ *
+ * Build and run with make, see the Makefile.
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include <I2C.h>
+#include <RgbLcdKeyShieldI2C.h>
+#include <LcdBacklightFader.h>
+#include <LcdCharset.h>
+#include <LcdGlyphCache.h>
+#include <LcdMenu.h>
+#include <LcdTicker.h>
+#include <LcdWidgets.h>
+#include <RgbLcdGroup.h>
+
+// all member functions are built, also the ones the benchmark doesn't call
+template class LcdHorizontalBar<RgbLcdKeyShieldI2C>;
+template class LcdVerticalBar<RgbLcdKeyShieldI2C>;
+template class LcdBigNumber<RgbLcdKeyShieldI2C, 3>;
+template class LcdNumberField<RgbLcdKeyShieldI2C, 8>;
+template class LcdMenu<RgbLcdKeyShieldI2C>;
+template class LcdGlyphCache<RgbLcdKeyShieldI2C>;
+template class LcdUtf8<RgbLcdKeyShieldI2C, LcdRomA00>;
+template class LcdUtf8<RgbLcdKeyShieldI2C, LcdRomA02>;
+template class LcdTicker<RgbLcdKeyShieldI2C>;
+template class LcdBacklightFader<RgbLcdKeyShieldI2C>;
+template class RgbLcdGroup<RgbLcdKeyShieldI2C>;
+
+uint32_t hostMicros = 0;
+uint8_t TWDR;
+I2C I2c;
+
+RgbLcdKeyShieldI2C lcd;
+LcdHorizontalBar<RgbLcdKeyShieldI2C> bar(lcd, 0, 0, 1, 16);
+LcdBigNumber<RgbLcdKeyShieldI2C, 3> bigNumber(lcd, 1, 0, 0);
+LcdNumberField<RgbLcdKeyShieldI2C, 8> field(lcd, 8, 1, 2);
+LcdGlyphCache<RgbLcdKeyShieldI2C> glyphs(lcd);
+LcdUtf8<RgbLcdKeyShieldI2C> text(lcd, glyphs);
+
+const char message[] PROGMEM = "Robotdyn test!";
+
+const uint8_t bell[8] PROGMEM = {
+		B00000000, 4, 14, 14, 14, 31, 4, B00000000 };
+
+/*
+ * The STARTs and bytes of an operation at a bus speed
+ */
+struct Expected {
+	unsigned long kHz;
+	char what[16];
+	unsigned long starts;
+	unsigned long bytes;
+};
+
+Expected baseline[64];
+uint8_t baselineCount = 0;
+// the file the results are written to instead of comparing them
+FILE *record = nullptr;
+unsigned long kHz;
+uint8_t regressions = 0;
+
+/*
+ * Reads the baseline, one operation per line: bus speed in kHz, name,
+ * STARTs and bytes separated by tabs
+ */
+bool readBaseline(const char *name) {
+	FILE *file = fopen(name, "r");
+	if (!file)
+		return false;
+	Expected *e = baseline;
+	while (baselineCount < sizeof(baseline) / sizeof(baseline[0])
+			&& fscanf(file, "%lu\t%15[^\t]\t%lu\t%lu\n", &e->kHz, e->what,
+					&e->starts, &e->bytes) == 4) {
+		baselineCount++;
+		e++;
+	}
+	fclose(file);
+	return true;
+}
+
+/*
+ * Compares the result of an operation with the baseline, more STARTs or
+ * bytes are a regression and so is an operation missing in the baseline
+ */
+void check(const char *what, uint32_t starts, uint32_t bytes) {
+	if (record) {
+		fprintf(record, "%lu\t%s\t%lu\t%lu\n", kHz, what,
+				(unsigned long) starts, (unsigned long) bytes);
+		return;
+	}
+	if (!baselineCount)
+		return;
+	for (uint8_t i = 0; i < baselineCount; i++) {
+		const Expected &e = baseline[i];
+		if (e.kHz != kHz || strcmp(e.what, what))
+			continue;
+		if (starts > e.starts || bytes > e.bytes) {
+			printf("  REGRESSION, baseline %lu starts, %lu bytes\n", e.starts,
+					e.bytes);
+			regressions++;
+		} else if (starts < e.starts || bytes < e.bytes)
+			puts("  better than the baseline, update it with make baseline");
+		return;
+	}
+	puts("  REGRESSION, not in the baseline");
+	regressions++;
+}
+
+/*
+ * Prints a line in the format of the Speedtest sketches
+ */
+void report(const char *what, uint8_t n, uint32_t time, uint32_t starts,
+		uint32_t bytes) {
+	printf("%-11s %2u in %5lu us = %6lu per s (%lu starts, %lu bytes)\n", what,
+			n, (unsigned long) time, (unsigned long) (n * 1000000UL / time),
+			(unsigned long) starts, (unsigned long) bytes);
+	check(what, starts, bytes);
+}
+
+/*
+ * Measures an operation that handles n characters, keys or special
+ * characters
+ */
+template <class Operation>
+void measure(const char *what, uint8_t n, Operation operation) {
+	I2c.reset();
+	uint32_t time = micros();
+	operation();
+	time = micros() - time;
+	report(what, n, time, I2c.starts, I2c.bytes);
+}
+
+void bench(uint32_t hz) {
+	I2c.setClock(hz);
+	lcd.setBusClock(hz);
+	lcd.begin();
+	kHz = hz / 1000;
+	printf("\nBus at %lu kHz\n\n", kHz);
+	measure("string", 14, [] {
+		lcd.print("Robotdyn test!");
+	});
+	measure("char", 1, [] {
+		lcd.print('C');
+	});
+	measure("printP", 14, [] {
+		lcd.printP(message);
+	});
+	measure("createChar", 1, [] {
+		lcd.createCharP(0, bell);
+	});
+	measure("read", 1, [] {
+		lcd.read();
+	});
+	uint8_t buffer[16];
+	lcd.setCursor(0, 0);
+	measure("read line", 16, [&buffer] {
+		lcd.read(buffer, 16);
+	});
+	measure("readKeys", 1, [] {
+		lcd.readKeys();
+	});
+	// the widgets after they were drawn once
+	lcd.clear();
+	bar.redraw();
+	bar.set(40);
+	measure("bar", 1, [] {
+		bar.set(41);
+	});
+	bigNumber.redraw();
+	bigNumber.set(123);
+	measure("big number", 1, [] {
+		bigNumber.set(124);
+	});
+	field.redraw();
+	field.set(12.34);
+	measure("field", 1, [] {
+		field.set(12.35);
+	});
+	glyphs.invalidate();
+	lcd.setCursor(0, 0);
+	measure("utf8", 10, [] {
+		text.print("Grüße 21°C");
+	});
+}
+
+/*
+ * Without arguments the results are only printed, with -c file they are
+ * compared with the baseline in the file and with -w file written to it
+ */
+int main(int argc, char *argv[]) {
+	if (argc == 3 && !strcmp(argv[1], "-c")) {
+		if (!readBaseline(argv[2])) {
+			printf("Can't read %s\n", argv[2]);
+			return 2;
+		}
+	} else if (argc == 3 && !strcmp(argv[1], "-w")) {
+		record = fopen(argv[2], "w");
+		if (!record) {
+			printf("Can't write %s\n", argv[2]);
+			return 2;
+		}
+	} else if (argc != 1) {
+		puts("Usage: HostBench [-c baseline | -w baseline]");
+		return 2;
+	}
+	puts("---RgbLcdKeyShieldI2C.h (simulated bus time)");
+	bench(100000);
+	bench(400000);
+	bench(1000000);
+	if (record)
+		fclose(record);
+	if (regressions) {
+		printf("\n%u regressions\n", regressions);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Stand-in for the I2C library from Wayne Truchsess so the library can be
+ * built and benchmarked on a Linux host, see HostBench.cpp
+ *
+ * Nothing is sent, but every START, address and data byte advances the
+ * simulated clock by the time it takes on the bus: nine clocks for a byte
+ * with its acknowledge and one clock for a START or STOP condition.
+ * The conditions, addresses and bytes sent are logged for TransportCheck.
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef I2C_h
+#define I2C_h
+
+#include "Arduino.h"
+
+#define SLA_W(address) (address << 1)
+#define SLA_R(address) ((address << 1) + 0x01)
+
+// the data register of the TWI hardware, always reads 0
+extern uint8_t TWDR;
+
+class I2C {
+public:
+	I2C() {
+		setClock(100000);
+		reset();
+	}
+	void begin() {
+	}
+	void pullup(uint8_t) {
+	}
+	void timeOut(uint16_t) {
+	}
+	// 0 is 100 kHz, 1 is 400 kHz as the real library
+	void setSpeed(uint8_t fast) {
+		setClock(fast ? 400000 : 100000);
+	}
+	// only in the stand-in, any bus speed in Hz
+	void setClock(uint32_t hz) {
+		_clock = hz;
+	}
+	void reset() {
+		starts = 0;
+		bytes = 0;
+		logLength = 0;
+		_nanos = 0;
+	}
+
+	uint8_t _start() {
+		starts++;
+		_log(busStart);
+		_clocks(1);
+		return 0;
+	}
+	uint8_t _sendAddress(uint8_t address) {
+		bytes++;
+		_log(address);
+		_clocks(9);
+		return 0;
+	}
+	uint8_t _sendByte(uint8_t data) {
+		bytes++;
+		_log(data);
+		_clocks(9);
+		return 0;
+	}
+	uint8_t _receiveByte(uint8_t) {
+		bytes++;
+		_clocks(9);
+		TWDR = 0;
+		return 0;
+	}
+	uint8_t _stop() {
+		_log(busStop);
+		_clocks(1);
+		return 0;
+	}
+	uint8_t write(uint8_t address, uint8_t registerAddress, uint8_t data) {
+		_start();
+		_sendAddress(SLA_W(address));
+		_sendByte(registerAddress);
+		_sendByte(data);
+		return _stop();
+	}
+	uint8_t read(uint8_t address, uint8_t registerAddress, uint8_t numberBytes) {
+		_start();
+		_sendAddress(SLA_W(address));
+		_sendByte(registerAddress);
+		_start();
+		_sendAddress(SLA_R(address));
+		while (numberBytes--)
+			_receiveByte(numberBytes);
+		return _stop();
+	}
+	// the keys are never pressed
+	uint8_t receive() {
+		return 0;
+	}
+
+	uint32_t starts;
+	uint32_t bytes;
+
+	// the addresses and bytes sent, the conditions are logged as
+	// busStart and busStop, the bytes received are not logged
+	enum events: uint16_t {
+		busStart = 0x100,
+		busStop = 0x200,
+		logSize = 4096
+	};
+	uint16_t log[logSize];
+	uint16_t logLength;
+
+private:
+	void _log(uint16_t event) {
+		if (logLength < logSize)
+			log[logLength++] = event;
+	}
+	void _clocks(uint8_t n) {
+		_nanos += n * (1000000000UL / _clock);
+		hostMicros += _nanos / 1000;
+		_nanos %= 1000;
+	}
+	uint32_t _clock;
+	uint32_t _nanos;
+};
+
+extern I2C I2c;
+
+#endif // I2C_h
@@ -0,0 +1,151 @@
+/*
+ * Host check of the transports of the RgbLcdKeyShieldI2C library
+ *
+ * Runs the same sequence through the I2C library, Wire and MockTransport.
+ * The traffic of I2C and Wire is decoded to the register accesses the
+ * MCP23017 sees, they must be the same although Wire splits long
+ * transmissions. MockTransport must record the same addresses and bytes
+ * as the I2C library sends.
+ *
+ * Build and run with make check, see the Makefile.
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include <I2C.h>
+#include "TransportCheck.h"
+
+uint32_t hostMicros = 0;
+uint8_t TWDR;
+I2C I2c;
+
+typedef MockTransportT<I2C::logSize> Mock;
+
+/*
+ * A register access as the MCP23017 sees it: the register in the high
+ * byte, the value written in the low byte, readAccess for a read
+ */
+enum accesses: uint16_t {
+	readAccess = 0x8000
+};
+
+struct Accesses {
+	uint16_t list[I2C::logSize];
+	uint16_t count;
+};
+
+/*
+ * Decodes the logged traffic, the first byte after the address selects
+ * the register, the following ones are written to it as sequential
+ * addressing is disabled. A read returns the selected register.
+ */
+void decode(Accesses &accesses) {
+	uint8_t reg = 0;
+	bool address = false;
+	bool selected = false;
+	accesses.count = 0;
+	for (uint16_t i = 0; i < I2c.logLength; i++) {
+		uint16_t event = I2c.log[i];
+		if (event == I2C::busStart) {
+			address = true;
+			continue;
+		}
+		if (event == I2C::busStop)
+			continue;
+		if (address) {
+			address = false;
+			selected = false;
+			if (event & 0x01)
+				accesses.list[accesses.count++] = readAccess | reg << 8;
+			continue;
+		}
+		if (!selected) {
+			reg = event;
+			selected = true;
+		} else
+			accesses.list[accesses.count++] = reg << 8 | event;
+	}
+}
+
+/*
+ * Prints the first difference, returns true if there is none
+ */
+bool compare(const char *what, const uint16_t *a, uint16_t countA,
+		const uint16_t *b, uint16_t countB) {
+	uint16_t n = 0;
+	while (n < countA && n < countB && a[n] == b[n])
+		n++;
+	if (n == countA && n == countB) {
+		printf("%-14s %4u identical\n", what, countA);
+		return true;
+	}
+	printf("%-14s differ at %u of %u and %u\n", what, n, countA, countB);
+	return false;
+}
+
+int main() {
+	bool passed = true;
+
+	// the I2C library
+	RgbLcdKeyShieldI2C lcd;
+	I2c.reset();
+	sequence(lcd);
+	static Accesses i2cAccesses;
+	decode(i2cAccesses);
+	uint32_t i2cStarts = I2c.starts;
+	// the addresses and bytes without the conditions
+	static uint16_t i2cBytes[I2C::logSize];
+	uint16_t i2cByteCount = 0;
+	for (uint16_t i = 0; i < I2c.logLength; i++)
+		if (I2c.log[i] < I2C::busStart)
+			i2cBytes[i2cByteCount++] = I2c.log[i];
+
+	// Wire
+	I2c.reset();
+	uint16_t dropped = wireSequence();
+	static Accesses wireAccesses;
+	decode(wireAccesses);
+	if (I2c.logLength == I2C::logSize || dropped) {
+		printf("Wire dropped %u bytes\n", dropped);
+		passed = false;
+	}
+	passed &= compare("I2C and Wire", i2cAccesses.list, i2cAccesses.count,
+			wireAccesses.list, wireAccesses.count);
+	printf("%-14s %4lu and %lu starts\n", "", (unsigned long) i2cStarts,
+			(unsigned long) I2c.starts);
+
+	// MockTransport
+	RgbLcdKeyShieldI2CT<AdafruitWiring, DefaultKeyTiming, Lcd16x2, Mock> mock;
+	Mock::clear();
+	sequence(mock);
+	static uint16_t mockBytes[I2C::logSize];
+	for (uint16_t i = 0; i < Mock::logLength; i++)
+		mockBytes[i] = Mock::log[i];
+	passed &= compare("I2C and Mock", i2cBytes, i2cByteCount, mockBytes,
+			Mock::logLength);
+	if (Mock::starts != i2cStarts) {
+		printf("Mock %u starts\n", Mock::starts);
+		passed = false;
+	}
+
+	if (i2cByteCount == I2C::logSize || Mock::logLength == I2C::logSize)
+		puts("log full, enlarge logSize");
+	puts(passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+/*
+ * The sequence of TransportCheck, built once for every transport
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TransportCheck_h
+#define TransportCheck_h
+
+#include <RgbLcdKeyShieldI2C.h>
+
+/*
+ * Uses the display like a sketch, with a string longer than the buffer of
+ * Wire, a special character, the keys and a read of the display
+ */
+template <class Lcd>
+void sequence(Lcd &lcd) {
+	static const uint8_t bell[8] = { 0, 4, 14, 14, 14, 31, 4, 0 };
+	lcd.begin();
+	lcd.print("Hello");
+	lcd.setCursor(0, 1);
+	lcd.print("Longer than 32 bytes on the bus");
+	lcd.createChar(0, bell);
+	lcd.setColor(Lcd::clTeal);
+	lcd.readKeys();
+	lcd.setCursor(2, 0);
+	lcd.read();
+	lcd.write((uint8_t) 0);
+	lcd.clear();
+	lcd.print('!');
+}
+
+// the sequence with the Wire transport, in TransportCheckWire.cpp
+uint16_t wireSequence();
+
+#endif // TransportCheck_h
@@ -0,0 +1,34 @@
+/*
+ * The part of TransportCheck built with Wire, RGBLCD_WIRE and ARDUINO
+ * are defined by the Makefile so RgbLcdTransport.h selects Wire
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TransportCheck.h"
+
+TwoWire Wire;
+
+/*
+ * Runs the sequence with Wire, returns the number of bytes that didn't
+ * fit in the buffer of Wire
+ */
+uint16_t wireSequence() {
+	RgbLcdKeyShieldI2CT<AdafruitWiring, DefaultKeyTiming, Lcd16x2,
+			WireTransport> lcd;
+	sequence(lcd);
+	return Wire.dropped;
+}
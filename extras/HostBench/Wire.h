@@ -0,0 +1,91 @@
+/*
+ * Stand-in for the Wire library so the Wire transport of the library can
+ * be checked on a Linux host, see TransportCheck.cpp
+ *
+ * Like Wire a transmission is collected in a buffer of 32 bytes and sent
+ * by endTransmission, bytes that don't fit are dropped. The transfers go
+ * through the stand-in of the I2C library, so they are timed and logged
+ * the same way.
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+#include "I2C.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire {
+public:
+	TwoWire() {
+		_length = 0;
+		_received = 0;
+		dropped = 0;
+	}
+	void begin() {
+	}
+	void beginTransmission(uint8_t address) {
+		_address = address;
+		_length = 0;
+	}
+	size_t write(uint8_t data) {
+		if (_length == BUFFER_LENGTH) {
+			dropped++;
+			return 0;
+		}
+		_buffer[_length++] = data;
+		return 1;
+	}
+	uint8_t endTransmission(bool sendStop = true) {
+		I2c._start();
+		I2c._sendAddress(SLA_W(_address));
+		for (uint8_t i = 0; i < _length; i++)
+			I2c._sendByte(_buffer[i]);
+		if (sendStop)
+			I2c._stop();
+		_length = 0;
+		return 0;
+	}
+	uint8_t requestFrom(uint8_t address, uint8_t quantity) {
+		I2c._start();
+		I2c._sendAddress(SLA_R(address));
+		for (uint8_t i = quantity; i > 0; i--) {
+			I2c._receiveByte(i - 1);
+			_received = TWDR;
+		}
+		I2c._stop();
+		return quantity;
+	}
+	int read() {
+		return _received;
+	}
+
+	// bytes that didn't fit in the buffer
+	uint16_t dropped;
+
+private:
+	uint8_t _address;
+	uint8_t _buffer[BUFFER_LENGTH];
+	uint8_t _length;
+	uint8_t _received;
+};
+
+extern TwoWire Wire;
+
+#endif // TwoWire_h
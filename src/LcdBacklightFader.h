@@ -0,0 +1,173 @@
+/*
+ * Dims and fades the backlight of RgbLcdKeyShieldI2C displays
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdBacklightFader_H
+#define LcdBacklightFader_H
+
+#include "RgbLcdKeyShieldI2C.h"
+
+/*
+ * Software PWM of the three leds of the backlight with 16 levels each.
+ * The leds are switched by setColor from update, which must be called
+ * as often as possible from the main loop; the bus can't be used from
+ * an interrupt while the main loop may be in the middle of a transmission.
+ *
+ * The time setColor takes on the bus is limited to a share of the time,
+ * 10% by default. When the share is used up a PWM step is postponed, so
+ * the PWM frequency drops but the brightness stays right.
+ *
+ * A PWM cycle has 15 steps, one per update, and at most five register
+ * writes of about 75 us at 400 kHz: switching on at the first step
+ * writes both ports, each led switches off with a write of its own.
+ * With the default share a cycle takes about 4 ms at 400 kHz, a PWM
+ * frequency of 250 Hz, and 16 ms at 100 kHz, 60 Hz which flickers.
+ * The number of writes and not the number of levels sets this limit,
+ * raise the share with setBusShare for a slow bus or a busy main loop.
+ */
+template <class Lcd>
+class LcdBacklightFader {
+public:
+	enum levels: uint8_t {
+		maxLevel = 15
+	};
+
+	LcdBacklightFader(Lcd &lcd);
+	void setBusShare(uint8_t percent);
+	void set(uint8_t red, uint8_t green, uint8_t blue);
+	void fadeTo(uint8_t red, uint8_t green, uint8_t blue, uint16_t ms);
+	bool fading();
+	void update();
+private:
+	enum budget: uint16_t {
+		maxCredit = 2000	// microseconds of bus time saved up at most
+	};
+	Lcd &_lcd;
+	// levels now and at the start and end of a fade
+	uint8_t _levels[3];
+	uint8_t _from[3];
+	uint8_t _to[3];
+	uint32_t _fadeStart;
+	uint16_t _fadeTime;
+	bool _fading;
+	// PWM step, the leds with a higher level are on
+	uint8_t _step;
+	uint8_t _color;
+	// bus time in microseconds that may still be used
+	uint8_t _share;
+	int32_t _credit;
+	uint32_t _lastUpdate;
+};
+
+template <class Lcd>
+LcdBacklightFader<Lcd>::LcdBacklightFader(Lcd& lcd) : _lcd(lcd) {
+	memset(_levels, 0, sizeof(_levels));
+	_fading = false;
+	_step = 0;
+	_color = 0xFF;	// unknown, the first update sets it
+	_share = 10;
+	_credit = 0;
+	_lastUpdate = micros();
+}
+
+/*
+ * Sets the maximum share of the time in percent that setColor may use
+ */
+template <class Lcd>
+void LcdBacklightFader<Lcd>::setBusShare(uint8_t percent) {
+	_share = percent > 100 ? 100 : percent;
+}
+
+/*
+ * Sets the levels of the leds, 0 (off) to maxLevel (on), stops a fade
+ */
+template <class Lcd>
+void LcdBacklightFader<Lcd>::set(uint8_t red, uint8_t green, uint8_t blue) {
+	_levels[0] = red > maxLevel ? (uint8_t) maxLevel : red;
+	_levels[1] = green > maxLevel ? (uint8_t) maxLevel : green;
+	_levels[2] = blue > maxLevel ? (uint8_t) maxLevel : blue;
+	_fading = false;
+}
+
+/*
+ * Changes the levels linearly to the given ones in ms milliseconds
+ */
+template <class Lcd>
+void LcdBacklightFader<Lcd>::fadeTo(uint8_t red, uint8_t green, uint8_t blue,
+		uint16_t ms) {
+	memcpy(_from, _levels, sizeof(_from));
+	set(red, green, blue);
+	memcpy(_to, _levels, sizeof(_to));
+	memcpy(_levels, _from, sizeof(_levels));
+	_fadeStart = millis();
+	_fadeTime = ms;
+	_fading = true;
+}
+
+/*
+ * Returns true while a fade is in progress
+ */
+template <class Lcd>
+bool LcdBacklightFader<Lcd>::fading() {
+	return _fading;
+}
+
+/*
+ * To be placed in the main loop, takes one PWM step if the bus share allows
+ */
+template <class Lcd>
+void LcdBacklightFader<Lcd>::update() {
+	uint32_t now = micros();
+	uint32_t elapsed = now - _lastUpdate;
+	_lastUpdate = now;
+	if (elapsed > maxCredit)
+		elapsed = maxCredit;
+	_credit += elapsed * _share / 100;
+	if (_credit > maxCredit)
+		_credit = maxCredit;
+	if (_fading) {
+		uint32_t time = millis() - _fadeStart;
+		if (time >= _fadeTime) {
+			memcpy(_levels, _to, sizeof(_levels));
+			_fading = false;
+		} else
+			for (uint8_t n = 0; n < 3; n++)
+				_levels[n] = _from[n] + ((int16_t) (_to[n] - _from[n]) * (int32_t) time)
+						/ _fadeTime;
+	}
+	if (_credit < 0)
+		return;
+	uint8_t color = 0;
+	if (_step < _levels[0])
+		color |= Lcd::clRed;
+	if (_step < _levels[1])
+		color |= Lcd::clGreen;
+	if (_step < _levels[2])
+		color |= Lcd::clBlue;
+	if (++_step == maxLevel)
+		_step = 0;
+	if (color == _color)
+		return;
+	_lcd.setColor((typename Lcd::colors) color);
+	_credit -= micros() - now;
+	_color = color;
+}
+
+#endif // LcdBacklightFader_H
@@ -0,0 +1,389 @@
+/*
+ * UTF-8 text on RgbLcdKeyShieldI2C displays
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdCharset_H
+#define LcdCharset_H
+
+#include "LcdGlyphCache.h"
+
+/*
+ * A character of the ROM and the code point it shows
+ */
+struct LcdCharMap {
+	uint16_t codepoint;
+	uint8_t code;
+};
+
+/*
+ * The character ROMs of the HD44780 are passed to LcdUtf8 as template
+ * parameter. translate returns the ROM code of a code point, 0 when the
+ * ROM doesn't have it. The maps are sorted by code point.
+ */
+struct LcdRom {
+protected:
+	static uint8_t _search(const LcdCharMap *map, uint8_t count,
+			uint16_t codepoint) {
+		uint8_t low = 0;
+		while (count) {
+			uint8_t half = count / 2;
+#ifdef __AVR__
+			uint16_t found = pgm_read_word(&map[low + half].codepoint);
+#else
+			uint16_t found = map[low + half].codepoint;
+#endif // __AVR__
+			if (found == codepoint) {
+#ifdef __AVR__
+				return pgm_read_byte(&map[low + half].code);
+#else
+				return map[low + half].code;
+#endif // __AVR__
+			}
+			if (found < codepoint) {
+				low += half + 1;
+				count -= half + 1;
+			} else
+				count = half;
+		}
+		return 0;
+	}
+};
+
+/*
+ * The Japanese ROM found on most displays, ASCII without backslash and
+ * tilde, katakana and some Greek and German characters
+ */
+struct LcdRomA00: LcdRom {
+	static uint8_t translate(uint16_t codepoint) {
+		static const LcdCharMap map[] PROGMEM = {
+				{ 0x00A2, 0xEC },	// ¢
+				{ 0x00A5, 0x5C },	// ¥
+				{ 0x00B0, 0xDF },	// °
+				{ 0x00B5, 0xE4 },	// µ
+				{ 0x00B7, 0xA5 },	// ·
+				{ 0x00DF, 0xE2 },	// ß
+				{ 0x00E4, 0xE1 },	// ä
+				{ 0x00F1, 0xEE },	// ñ
+				{ 0x00F6, 0xEF },	// ö
+				{ 0x00F7, 0xFD },	// ÷
+				{ 0x00FC, 0xF5 },	// ü
+				{ 0x03A3, 0xF6 },	// Σ
+				{ 0x03A9, 0xF4 },	// Ω
+				{ 0x03B1, 0xE0 },	// α
+				{ 0x03B2, 0xE2 },	// β
+				{ 0x03B5, 0xE3 },	// ε
+				{ 0x03B8, 0xF2 },	// θ
+				{ 0x03BC, 0xE4 },	// μ
+				{ 0x03C0, 0xF7 },	// π
+				{ 0x03C1, 0xE6 },	// ρ
+				{ 0x03C3, 0xE5 },	// σ
+				{ 0x2190, 0x7F },	// ←
+				{ 0x2192, 0x7E },	// →
+				{ 0x221A, 0xE8 },	// √
+				{ 0x221E, 0xF3 },	// ∞
+				{ 0x2588, 0xFF }	// █
+		};
+		if (codepoint >= 0x20 && codepoint < 0x7E && codepoint != '\\')
+			return codepoint;
+		return _search(map, sizeof(map) / sizeof(map[0]), codepoint);
+	}
+};
+
+/*
+ * The European ROM, ASCII and most of Latin-1
+ */
+struct LcdRomA02: LcdRom {
+	static uint8_t translate(uint16_t codepoint) {
+		static const LcdCharMap map[] PROGMEM = {
+				{ 0x00A1, 0xA1 },	// ¡
+				{ 0x00A2, 0xA2 },	// ¢
+				{ 0x00A3, 0xA3 },	// £
+				{ 0x00A4, 0xA4 },	// ¤
+				{ 0x00A5, 0xA5 },	// ¥
+				{ 0x00A6, 0xA6 },	// ¦
+				{ 0x00A7, 0xA7 },	// §
+				{ 0x00A9, 0xA9 },	// ©
+				{ 0x00AA, 0xAA },	// ª
+				{ 0x00AB, 0xAB },	// «
+				{ 0x00AE, 0xAE },	// ®
+				{ 0x00B0, 0xB0 },	// °
+				{ 0x00B1, 0xB1 },	// ±
+				{ 0x00B2, 0xB2 },	// ²
+				{ 0x00B3, 0xB3 },	// ³
+				{ 0x00B5, 0xB5 },	// µ
+				{ 0x00B6, 0xB6 },	// ¶
+				{ 0x00B7, 0xB7 },	// ·
+				{ 0x00B9, 0xB9 },	// ¹
+				{ 0x00BA, 0xBA },	// º
+				{ 0x00BB, 0xBB },	// »
+				{ 0x00BC, 0xBC },	// ¼
+				{ 0x00BD, 0xBD },	// ½
+				{ 0x00BE, 0xBE },	// ¾
+				{ 0x00BF, 0xBF },	// ¿
+				{ 0x03BC, 0xB5 },	// μ
+				{ 0x03C9, 0xB8 }	// ω
+		};
+		if ((codepoint >= 0x20 && codepoint < 0x7F)
+				|| (codepoint >= 0xC0 && codepoint <= 0xFF))
+			return codepoint;
+		return _search(map, sizeof(map) / sizeof(map[0]), codepoint);
+	}
+};
+
+/*
+ * Prints UTF-8 text, e.g. string literals of a localized sketch:
+ *
+ *   LcdGlyphCache<RgbLcdKeyShieldI2C> glyphs(lcd);
+ *   LcdUtf8<RgbLcdKeyShieldI2C> text(lcd, glyphs);
+ *   text.print("Température 21°C");
+ *
+ * Code points in the ROM are printed with their ROM code. For the accented
+ * letters of German and French, backslash, tilde and the euro sign that
+ * the ROM lacks a glyph is loaded in CGRAM by the glyph cache, at most
+ * eight different ones can be on the screen. Anything else, and invalid
+ * or broken off UTF-8, is printed as '?'. Code points below 0x20 are
+ * passed on, so the special characters 0 to 7 can still be printed.
+ *
+ * A buffer is decoded into chunks that are written with the write of the
+ * display in one batch, so the text is streamed in a single transmission.
+ * Code points above 0xFFFF are not supported.
+ */
+template <class Lcd, class Rom = LcdRomA00>
+class LcdUtf8: public Print {
+public:
+	enum cells: uint8_t {
+		replacementCell = '?'
+	};
+
+	LcdUtf8(Lcd &lcd, LcdGlyphCache<Lcd> &glyphs);
+	using Print::write; // pull in write(str) from Print
+	virtual size_t write(uint8_t c);
+	size_t write(const uint8_t *buffer, size_t size) override;
+#ifdef __AVR__
+	size_t printP(const char str[]);
+#endif // __AVR__
+	uint8_t translate(uint16_t codepoint);
+private:
+	enum sizes: uint8_t {
+		chunkSize = 16
+	};
+	struct Glyph {
+		uint16_t codepoint;
+		uint8_t bitmap[8];
+	};
+
+	uint8_t _decode(uint8_t c, uint16_t *codepoints);
+	uint8_t _glyph(uint16_t codepoint);
+
+	Lcd &_lcd;
+	LcdGlyphCache<Lcd> &_glyphs;
+	// the code point being decoded and the continuation bytes still expected
+	uint16_t _codepoint;
+	uint8_t _pending;
+	bool _invalid;
+
+	static const Glyph _glyphMaps[];
+};
+
+/*
+ * The glyphs for the code points missing in a ROM, sorted by code point
+ */
+template <class Lcd, class Rom>
+const typename LcdUtf8<Lcd, Rom>::Glyph LcdUtf8<Lcd, Rom>::_glyphMaps[] PROGMEM = {
+		{ 0x005C, { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00 } },	// backslash
+		{ 0x007E, { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00 } },	// ~
+		{ 0x00C4, { 0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x11, 0x11, 0x00 } },	// Ä
+		{ 0x00D6, { 0x0A, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 } },	// Ö
+		{ 0x00DC, { 0x0A, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 } },	// Ü
+		{ 0x00E0, { 0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },	// à
+		{ 0x00E2, { 0x04, 0x0A, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },	// â
+		{ 0x00E7, { 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x04, 0x0C } },	// ç
+		{ 0x00E8, { 0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },	// è
+		{ 0x00E9, { 0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },	// é
+		{ 0x00EA, { 0x04, 0x0A, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },	// ê
+		{ 0x00EB, { 0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },	// ë
+		{ 0x00EE, { 0x04, 0x0A, 0x00, 0x0C, 0x04, 0x04, 0x0E, 0x00 } },	// î
+		{ 0x00EF, { 0x0A, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 } },	// ï
+		{ 0x00F4, { 0x04, 0x0A, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 } },	// ô
+		{ 0x00F9, { 0x08, 0x04, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 } },	// ù
+		{ 0x00FB, { 0x04, 0x0A, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 } },	// û
+		{ 0x20AC, { 0x06, 0x09, 0x1E, 0x08, 0x1E, 0x09, 0x06, 0x00 } }	// €
+};
+
+template <class Lcd, class Rom>
+LcdUtf8<Lcd, Rom>::LcdUtf8(Lcd& lcd, LcdGlyphCache<Lcd>& glyphs) :
+		_lcd(lcd), _glyphs(glyphs) {
+	_codepoint = 0;
+	_pending = 0;
+	_invalid = false;
+}
+
+/*
+ * Decodes a byte, the character is written when its last byte arrives
+ */
+template <class Lcd, class Rom>
+size_t LcdUtf8<Lcd, Rom>::write(uint8_t c) {
+	uint16_t codepoints[2];
+	uint8_t count = _decode(c, codepoints);
+	if (count == 1)
+		_lcd.write(translate(codepoints[0]));
+	else if (count) {
+		uint8_t codes[2] = { translate(codepoints[0]), translate(codepoints[1]) };
+		_lcd.write(codes, count);
+	}
+	return 1;
+}
+
+/*
+ * Overrides the standard implementation
+ */
+template <class Lcd, class Rom>
+size_t LcdUtf8<Lcd, Rom>::write(const uint8_t* buffer, size_t size) {
+	uint8_t chunk[chunkSize];
+	uint8_t length = 0;
+	_lcd.beginBatch();
+	for (size_t n = 0; n < size; n++) {
+		uint16_t codepoints[2];
+		uint8_t count = _decode(buffer[n], codepoints);
+		for (uint8_t i = 0; i < count; i++)
+			chunk[length++] = translate(codepoints[i]);
+		// a byte gives at most two characters
+		if (length > chunkSize - 2) {
+			_lcd.write(chunk, length);
+			length = 0;
+		}
+	}
+	if (length)
+		_lcd.write(chunk, length);
+	_lcd.endBatch();
+	return size;
+}
+
+#ifdef __AVR__
+/*
+ * Writes a string in program memory to the display
+ */
+template <class Lcd, class Rom>
+size_t LcdUtf8<Lcd, Rom>::printP(const char str[]) {
+	uint8_t chunk[chunkSize];
+	size_t n = 0;
+	uint8_t c = pgm_read_byte(&str[n]);
+	_lcd.beginBatch();
+	while (c) {
+		uint8_t length = 0;
+		while (c && length < chunkSize) {
+			chunk[length++] = c;
+			c = pgm_read_byte(&str[++n]);
+		}
+		write(chunk, length);
+	}
+	_lcd.endBatch();
+	return n;
+}
+#endif // __AVR__
+
+/*
+ * Returns the character code that shows a code point: the ROM code, the
+ * slot of a glyph loaded in CGRAM or replacementCell
+ */
+template <class Lcd, class Rom>
+uint8_t LcdUtf8<Lcd, Rom>::translate(uint16_t codepoint) {
+	if (codepoint < 0x20)
+		return codepoint;
+	uint8_t code = Rom::translate(codepoint);
+	if (code)
+		return code;
+	return _glyph(codepoint);
+}
+
+/*
+ * Helper function to decode a byte, returns the number of complete
+ * characters placed in codepoints: 0, 1, or 2 when the byte breaks off
+ * a sequence and the broken sequence gives 0xFFFF before it
+ */
+template <class Lcd, class Rom>
+uint8_t LcdUtf8<Lcd, Rom>::_decode(uint8_t c, uint16_t* codepoints) {
+	uint8_t count = 0;
+	if (_pending) {
+		if ((c & 0xC0) == 0x80) {
+			_codepoint = _codepoint << 6 | (c & 0x3F);
+			if (--_pending)
+				return 0;
+			codepoints[0] = _invalid ? 0xFFFF : _codepoint;
+			return 1;
+		}
+		// the sequence broke off, the byte starts a new character
+		_pending = 0;
+		codepoints[count++] = 0xFFFF;
+	}
+	_invalid = false;
+	if (c < 0x80) {
+		codepoints[count++] = c;
+		return count;
+	}
+	if ((c & 0xE0) == 0xC0) {
+		_codepoint = c & 0x1F;
+		_pending = 1;
+	} else if ((c & 0xF0) == 0xE0) {
+		_codepoint = c & 0x0F;
+		_pending = 2;
+	} else if ((c & 0xF8) == 0xF0) {
+		// beyond 0xFFFF, only the bytes are skipped
+		_invalid = true;
+		_pending = 3;
+	} else
+		// a continuation byte without start
+		codepoints[count++] = 0xFFFF;
+	return count;
+}
+
+/*
+ * Helper function to load the glyph of a code point the ROM lacks
+ */
+template <class Lcd, class Rom>
+uint8_t LcdUtf8<Lcd, Rom>::_glyph(uint16_t codepoint) {
+	uint8_t low = 0;
+	uint8_t count = sizeof(_glyphMaps) / sizeof(_glyphMaps[0]);
+	while (count) {
+		uint8_t half = count / 2;
+		const Glyph *glyph = &_glyphMaps[low + half];
+#ifdef __AVR__
+		uint16_t found = pgm_read_word(&glyph->codepoint);
+#else
+		uint16_t found = glyph->codepoint;
+#endif // __AVR__
+		if (found == codepoint) {
+#ifdef __AVR__
+			uint8_t slot = _glyphs.useP(glyph->bitmap);
+#else
+			uint8_t slot = _glyphs.use(glyph->bitmap);
+#endif // __AVR__
+			return slot == LcdGlyphCache<Lcd>::noSlot ? (uint8_t) replacementCell : slot;
+		}
+		if (found < codepoint) {
+			low += half + 1;
+			count -= half + 1;
+		} else
+			count = half;
+	}
+	return replacementCell;
+}
+
+#endif // LcdCharset_H
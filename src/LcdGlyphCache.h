@@ -0,0 +1,192 @@
+/*
+ * Manages the eight special characters of an RgbLcdKeyShieldI2C display
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdGlyphCache_H
+#define LcdGlyphCache_H
+
+#include "RgbLcdKeyShieldI2C.h"
+
+/*
+ * Instead of picking a slot for createChar, the application asks for a
+ * glyph by its bitmap and prints the returned character code:
+ *
+ *   lcd.write(glyphs.use(bell));
+ *
+ * A glyph already in CGRAM is not uploaded again. Otherwise the slot that
+ * was used longest ago is overwritten, so a glyph still on the screen
+ * changes when more than eight different glyphs are in use. Reserved
+ * slots are left to the application.
+ */
+template <class Lcd>
+class LcdGlyphCache {
+public:
+	enum slots: uint8_t {
+		slotCount = 8,
+		noSlot = 0xFF
+	};
+
+	LcdGlyphCache(Lcd &lcd);
+	uint8_t use(const uint8_t *bitmap);
+#ifdef __AVR__
+	uint8_t useP(const uint8_t *bitmap);
+#endif // __AVR__
+	uint8_t find(const uint8_t *bitmap);
+	void reserve(uint8_t slot);
+	void invalidate();
+private:
+	uint8_t _hash(const uint8_t *bitmap);
+	uint8_t _find(const uint8_t *bitmap, uint8_t hash);
+	void _touch(uint8_t slot);
+
+	Lcd &_lcd;
+	// copy of the CGRAM, the hash only speeds up the search
+	uint8_t _bitmaps[slotCount][8];
+	uint8_t _hashes[slotCount];
+	// rank of the last use of the slot, 0 for the most recent use and 7
+	// for the least recent, every rank is held by one slot
+	uint8_t _ages[slotCount];
+	// bit masks of the slots holding a known glyph and of the reserved ones
+	uint8_t _valid;
+	uint8_t _reserved;
+};
+
+template <class Lcd>
+LcdGlyphCache<Lcd>::LcdGlyphCache(Lcd& lcd) : _lcd(lcd) {
+	_reserved = 0;
+	invalidate();
+}
+
+/*
+ * Returns the character code of the glyph, uploads it when it is not in
+ * CGRAM. Returns noSlot when all slots are reserved.
+ */
+template <class Lcd>
+uint8_t LcdGlyphCache<Lcd>::use(const uint8_t* bitmap) {
+	uint8_t hash = _hash(bitmap);
+	uint8_t slot = _find(bitmap, hash);
+	if (slot != noSlot) {
+		_touch(slot);
+		return slot;
+	}
+	// an empty slot or else the least recently used one
+	for (uint8_t n = 0; n < slotCount; n++) {
+		if (_reserved & (1 << n))
+			continue;
+		if (slot == noSlot || !(_valid & (1 << n)) || _ages[n] > _ages[slot]) {
+			slot = n;
+			if (!(_valid & (1 << n)))
+				break;
+		}
+	}
+	if (slot == noSlot)
+		return noSlot;
+	memcpy(_bitmaps[slot], bitmap, 8);
+	_hashes[slot] = hash;
+	_valid |= 1 << slot;
+	_lcd.createChar(slot, bitmap);
+	_touch(slot);
+	return slot;
+}
+
+#ifdef __AVR__
+/*
+ * As use but with the bitmap in program memory
+ */
+template <class Lcd>
+uint8_t LcdGlyphCache<Lcd>::useP(const uint8_t* bitmap) {
+	uint8_t copy[8];
+	for (uint8_t n = 0; n < 8; n++)
+		copy[n] = pgm_read_byte(&bitmap[n]);
+	return use(copy);
+}
+#endif // __AVR__
+
+/*
+ * Returns the character code of the glyph if it is in CGRAM,
+ * otherwise noSlot. Nothing is uploaded.
+ */
+template <class Lcd>
+uint8_t LcdGlyphCache<Lcd>::find(const uint8_t* bitmap) {
+	return _find(bitmap, _hash(bitmap));
+}
+
+/*
+ * Keeps the cache away from a slot, e.g. for a glyph loaded with createChar
+ */
+template <class Lcd>
+void LcdGlyphCache<Lcd>::reserve(uint8_t slot) {
+	slot &= 0x7;
+	_reserved |= 1 << slot;
+	_valid &= ~(1 << slot);
+}
+
+/*
+ * Forgets the content of CGRAM, to be called after begin
+ */
+template <class Lcd>
+void LcdGlyphCache<Lcd>::invalidate() {
+	_valid = 0;
+	for (uint8_t n = 0; n < slotCount; n++)
+		_ages[n] = n;
+}
+
+/*
+ * Helper function to hash a bitmap, only the five pixel columns count
+ */
+template <class Lcd>
+uint8_t LcdGlyphCache<Lcd>::_hash(const uint8_t* bitmap) {
+	uint8_t hash = 0;
+	for (uint8_t n = 0; n < 8; n++)
+		hash = ((hash << 3) | (hash >> 5)) ^ (bitmap[n] & 0x1F);
+	return hash;
+}
+
+/*
+ * Helper function to find the slot holding a bitmap
+ */
+template <class Lcd>
+uint8_t LcdGlyphCache<Lcd>::_find(const uint8_t* bitmap, uint8_t hash) {
+	for (uint8_t slot = 0; slot < slotCount; slot++) {
+		if (!(_valid & (1 << slot)) || _hashes[slot] != hash)
+			continue;
+		uint8_t n = 0;
+		while (n < 8 && (_bitmaps[slot][n] & 0x1F) == (bitmap[n] & 0x1F))
+			n++;
+		if (n == 8)
+			return slot;
+	}
+	return noSlot;
+}
+
+/*
+ * Helper function to make a slot the most recently used, the slots
+ * used more recently than it move one rank down
+ */
+template <class Lcd>
+void LcdGlyphCache<Lcd>::_touch(uint8_t slot) {
+	uint8_t age = _ages[slot];
+	for (uint8_t n = 0; n < slotCount; n++)
+		if (_ages[n] < age)
+			_ages[n]++;
+	_ages[slot] = 0;
+}
+
+#endif // LcdGlyphCache_H
@@ -0,0 +1,302 @@
+/*
+ * Menus in program memory for RgbLcdKeyShieldI2C displays
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdMenu_H
+#define LcdMenu_H
+
+#include "LcdWidgets.h"
+
+/*
+ * An entry of a menu, the arrays of entries and the labels are
+ * placed in program memory:
+ *
+ *   const char labelRed[] PROGMEM = "Red";
+ *   const char labelBlue[] PROGMEM = "Blue";
+ *   const char labelColor[] PROGMEM = "Color";
+ *   const LcdMenuItem colorMenu[] PROGMEM = {
+ *       { labelRed, nullptr, 0, setRed },
+ *       { labelBlue, nullptr, 0, setBlue } };
+ *   const LcdMenuItem mainMenu[] PROGMEM = {
+ *       { labelColor, colorMenu, 2, nullptr } };
+ *
+ *   LcdMenu<RgbLcdKeyShieldI2C> menu(lcd, mainMenu, 1);
+ */
+struct LcdMenuItem {
+	const char *label;
+	// the submenu and its number of entries, nullptr for an action
+	const LcdMenuItem *items;
+	uint8_t count;
+	// called when the entry is chosen
+	void (*action)();
+};
+
+/*
+ * Shows a menu with one entry per row and an arrow before the selected
+ * one. Up and down select, right and select open a submenu or call the
+ * action, left returns to the previous menu. Navigating writes only the
+ * cells that change: moving the arrow costs two cells, scrolling only
+ * the characters in which the labels differ. The display is never
+ * cleared. Only the pointer of the label shown on each row is kept in
+ * RAM, the labels are compared in program memory.
+ */
+template <class Lcd, uint8_t maxDepth = 4>
+class LcdMenu: public LcdWidget<Lcd> {
+public:
+	enum cells: uint8_t {
+		selectedCell = 0x7E	// right arrow in the character ROM
+	};
+
+	LcdMenu(Lcd &lcd, const LcdMenuItem *menu, uint8_t count);
+	void begin();
+	void press(uint8_t keys);
+	void redraw();
+	uint8_t selected();
+private:
+	enum size: uint8_t {
+		columns = Lcd::displayColumns,
+		rows = Lcd::displayRows
+	};
+
+	static LcdMenuItem _item(const LcdMenuItem *item);
+	static char _char(const char *label, uint8_t n);
+	void _draw();
+	void _drawRow(uint8_t row, const char *label, bool selected);
+	static void _up();
+	static void _down();
+	static void _enter();
+	static void _back();
+
+	// the menus from the main menu to the current one
+	const LcdMenuItem *_menus[maxDepth];
+	uint8_t _counts[maxDepth];
+	uint8_t _selected[maxDepth];
+	uint8_t _tops[maxDepth];
+	uint8_t _depth;
+	// label shown on each row, nullptr when unknown,
+	// and a bit for every row showing the arrow
+	const char *_shown[rows];
+	uint8_t _arrows;
+
+	static LcdMenu *_active;
+	static const char _empty[];
+};
+
+template <class Lcd, uint8_t maxDepth>
+LcdMenu<Lcd, maxDepth> *LcdMenu<Lcd, maxDepth>::_active = nullptr;
+
+template <class Lcd, uint8_t maxDepth>
+const char LcdMenu<Lcd, maxDepth>::_empty[] PROGMEM = "";
+
+template <class Lcd, uint8_t maxDepth>
+LcdMenu<Lcd, maxDepth>::LcdMenu(Lcd& lcd, const LcdMenuItem* menu,
+		uint8_t count) : LcdWidget<Lcd>(lcd) {
+	_menus[0] = menu;
+	_counts[0] = count;
+	_selected[0] = 0;
+	_tops[0] = 0;
+	_depth = 0;
+	for (uint8_t row = 0; row < rows; row++)
+		_shown[row] = nullptr;
+	_arrows = 0;
+}
+
+/*
+ * Takes over the keys and draws the menu, also to return to the
+ * menu after an action used the keys or the display
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::begin() {
+	_active = this;
+	this->_lcd.clearKeys();
+	this->_lcd.keyUp.onShortPress = _up;
+	this->_lcd.keyUp.onRepPress = _up;
+	this->_lcd.keyDown.onShortPress = _down;
+	this->_lcd.keyDown.onRepPress = _down;
+	this->_lcd.keyRight.onShortPress = _enter;
+	this->_lcd.keySelect.onShortPress = _enter;
+	this->_lcd.keyLeft.onShortPress = _back;
+	redraw();
+}
+
+/*
+ * Navigates with the keys of a KeyEvent, for use with readKeyEvent
+ * instead of the callbacks set by begin
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::press(uint8_t keys) {
+	uint8_t &selected = _selected[_depth];
+	uint8_t count = _counts[_depth];
+	if (!count)
+		return;
+	if (keys & KeyEvent::kmUp)
+		selected = selected ? selected - 1 : count - 1;
+	else if (keys & KeyEvent::kmDown)
+		selected = selected + 1 < count ? selected + 1 : 0;
+	else if (keys & (KeyEvent::kmRight | KeyEvent::kmSelect)) {
+		LcdMenuItem item = _item(&_menus[_depth][selected]);
+		if (item.items && _depth + 1 < maxDepth) {
+			_depth++;
+			_menus[_depth] = item.items;
+			_counts[_depth] = item.count;
+			_selected[_depth] = 0;
+			_tops[_depth] = 0;
+		} else {
+			if (item.action)
+				item.action();
+			return;
+		}
+	} else if (keys & KeyEvent::kmLeft) {
+		if (!_depth)
+			return;
+		_depth--;
+	} else
+		return;
+	_draw();
+}
+
+/*
+ * Draws the complete menu again, after the display was used otherwise
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::redraw() {
+	for (uint8_t row = 0; row < rows; row++)
+		_shown[row] = nullptr;
+	_arrows = 0;
+	_draw();
+}
+
+/*
+ * Returns the index of the selected entry in the current menu
+ */
+template <class Lcd, uint8_t maxDepth>
+uint8_t LcdMenu<Lcd, maxDepth>::selected() {
+	return _selected[_depth];
+}
+
+/*
+ * Helper function to copy an entry from program memory
+ */
+template <class Lcd, uint8_t maxDepth>
+LcdMenuItem LcdMenu<Lcd, maxDepth>::_item(const LcdMenuItem* item) {
+	LcdMenuItem copy;
+#ifdef __AVR__
+	memcpy_P(&copy, item, sizeof(copy));
+#else
+	copy = *item;
+#endif // __AVR__
+	return copy;
+}
+
+/*
+ * Helper function to read a character of a label in program memory
+ */
+template <class Lcd, uint8_t maxDepth>
+char LcdMenu<Lcd, maxDepth>::_char(const char* label, uint8_t n) {
+#ifdef __AVR__
+	return pgm_read_byte(&label[n]);
+#else
+	return label[n];
+#endif // __AVR__
+}
+
+/*
+ * Helper function to scroll the selected entry into view and
+ * draw the rows that changed
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_draw() {
+	uint8_t selected = _selected[_depth];
+	uint8_t &top = _tops[_depth];
+	if (selected < top)
+		top = selected;
+	else if (selected >= top + rows)
+		top = selected - rows + 1;
+	this->_begin();
+	for (uint8_t row = 0; row < rows; row++) {
+		uint8_t n = top + row;
+		const char *label = _empty;
+		if (n < _counts[_depth])
+			label = _item(&_menus[_depth][n]).label;
+		_drawRow(row, label, n == selected);
+	}
+	this->_end();
+}
+
+/*
+ * Helper function to draw a row, only the cells that differ
+ * from what the row shows are written
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_drawRow(uint8_t row, const char* label,
+		bool selected) {
+	const char *shown = _shown[row];
+	if (!shown || selected != (bool) (_arrows & (1 << row))) {
+		this->_put(0, row, selected ? (uint8_t) selectedCell
+				: (uint8_t) LcdWidget<Lcd>::blankCell);
+		if (selected)
+			_arrows |= 1 << row;
+		else
+			_arrows &= ~(1 << row);
+	}
+	if (label == shown)
+		return;
+	// past the end of a label the row is blank
+	bool ended = false;
+	bool shownEnded = !shown;
+	for (uint8_t col = 1; col < columns; col++) {
+		char c = ended ? 0 : _char(label, col - 1);
+		ended = !c;
+		char s = shownEnded ? 0 : _char(shown, col - 1);
+		shownEnded = !s;
+		if (!shown || c != s)
+			this->_put(col, row, c ? (uint8_t) c : (uint8_t) LcdWidget<Lcd>::blankCell);
+	}
+	_shown[row] = label;
+}
+
+/*
+ * Helper functions for the callbacks of the keys
+ */
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_up() {
+	if (_active)
+		_active->press(KeyEvent::kmUp);
+}
+
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_down() {
+	if (_active)
+		_active->press(KeyEvent::kmDown);
+}
+
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_enter() {
+	if (_active)
+		_active->press(KeyEvent::kmSelect);
+}
+
+template <class Lcd, uint8_t maxDepth>
+void LcdMenu<Lcd, maxDepth>::_back() {
+	if (_active)
+		_active->press(KeyEvent::kmLeft);
+}
+
+#endif // LcdMenu_H
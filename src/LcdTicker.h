@@ -0,0 +1,184 @@
+/*
+ * Scrolling text on RgbLcdKeyShieldI2C displays with the display shift
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdTicker_H
+#define LcdTicker_H
+
+#include "RgbLcdKeyShieldI2C.h"
+
+/*
+ * Each line of the lcd holds 40 characters of which only the first
+ * columns are visible. A step of the ticker is a single display shift
+ * to the left, the text for the cells that come into view is already
+ * in the lcd. Once all cells out of view have been shown, they are
+ * refilled with the text that follows in one run.
+ *
+ * The shift moves all rows, so the ticker owns the display: every row
+ * scrolls its own text, rows without text scroll whatever they hold.
+ * Only for displays of two rows, without frame buffer and line wrap.
+ * The text is not copied and must stay valid, it repeats endlessly.
+ */
+template <class Lcd>
+class LcdTicker {
+public:
+	LcdTicker(Lcd &lcd);
+	void setText(uint8_t row, const char *text);
+	void setInterval(uint16_t ms);
+	void start();
+	void step();
+	void update();
+private:
+	enum lineSize: uint8_t {
+		columns = Lcd::displayColumns,
+		rows = Lcd::displayRows,
+		lineCells = 40,
+		hiddenCells = lineCells - columns
+	};
+	static_assert(rows == 2, "the display shift moves the rows of a 4 row display apart");
+	static_assert(columns < lineCells, "no cells out of view to preload");
+
+	void _fill(uint8_t row, uint8_t first, uint8_t count);
+
+	Lcd &_lcd;
+	const char *_texts[rows];
+	uint8_t _lengths[rows];
+	// position in the text of the leftmost visible cell
+	uint8_t _positions[rows];
+	// cell of the line shown leftmost and cells out of view to refill
+	uint8_t _shift;
+	uint8_t _stale;
+	uint16_t _interval;
+	uint32_t _stepTime;
+};
+
+template <class Lcd>
+LcdTicker<Lcd>::LcdTicker(Lcd& lcd) : _lcd(lcd) {
+	for (uint8_t row = 0; row < rows; row++) {
+		_texts[row] = nullptr;
+		_lengths[row] = 0;
+		_positions[row] = 0;
+	}
+	_shift = 0;
+	_stale = 0;
+	_interval = 300;
+	_stepTime = 0;
+}
+
+/*
+ * Sets the text of a row, at most 255 characters, nullptr for none.
+ * Takes effect with start.
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::setText(uint8_t row, const char* text) {
+	if (row >= rows)
+		return;
+	_texts[row] = text;
+	_lengths[row] = text ? strnlen(text, 0xFF) : 0;
+	_positions[row] = 0;
+}
+
+/*
+ * Sets the time between two steps of update in milliseconds
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::setInterval(uint16_t ms) {
+	_interval = ms;
+}
+
+/*
+ * Returns the display to its unshifted position with home and writes the
+ * text of all rows into the complete lines
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::start() {
+	_lcd.home();
+	_shift = 0;
+	_stale = 0;
+	_lcd.beginBatch();
+	for (uint8_t row = 0; row < rows; row++)
+		_fill(row, 0, lineCells);
+	_lcd.endBatch();
+	_stepTime = millis();
+}
+
+/*
+ * Moves the text one cell to the left
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::step() {
+	_lcd.beginBatch();
+	if (_stale == hiddenCells) {
+		// the next cell to come into view is out of date
+		for (uint8_t row = 0; row < rows; row++)
+			_fill(row, columns, hiddenCells);
+		_stale = 0;
+	}
+	_lcd.scrollDisplayLeft();
+	_lcd.endBatch();
+	if (++_shift == lineCells)
+		_shift = 0;
+	// the cell that went out of view is now the last of the line
+	_stale++;
+	for (uint8_t row = 0; row < rows; row++)
+		if (_lengths[row] && ++_positions[row] == _lengths[row])
+			_positions[row] = 0;
+}
+
+/*
+ * To be placed in the main loop, steps when the interval has passed
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::update() {
+	uint32_t now = millis();
+	if (now - _stepTime < _interval)
+		return;
+	_stepTime = now;
+	step();
+}
+
+/*
+ * Helper function to write the text of a row into count cells, starting
+ * at first cells right of the leftmost visible one. The address of the
+ * lcd jumps from the end of a line to the next line, so the run is split
+ * where it passes the end.
+ */
+template <class Lcd>
+void LcdTicker<Lcd>::_fill(uint8_t row, uint8_t first, uint8_t count) {
+	uint8_t length = _lengths[row];
+	if (!length)
+		return;
+	uint8_t cell = _shift + first;
+	if (cell >= lineCells)
+		cell -= lineCells;
+	uint8_t position = (_positions[row] + first) % length;
+	_lcd.setCursor(cell, row);
+	while (count--) {
+		_lcd.write(_texts[row][position]);
+		if (++position == length)
+			position = 0;
+		if (++cell == lineCells && count) {
+			cell = 0;
+			_lcd.setCursor(cell, row);
+		}
+	}
+}
+
+#endif // LcdTicker_H
@@ -0,0 +1,615 @@
+/*
+ * Bar graphs, big numbers and number fields for RgbLcdKeyShieldI2C displays
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef LcdWidgets_H
+#define LcdWidgets_H
+
+#include "RgbLcdKeyShieldI2C.h"
+
+/*
+ * The widgets remember what they have drawn. An update only sends the
+ * cells and special character rows that differ from the previous value,
+ * all in one batch. Adjacent cells are written without a setCursor.
+ * Each widget uses its own special characters, given as slot to the
+ * constructor, and leaves the cursor after the last cell it wrote.
+ * After a clear of the display call redraw.
+ */
+template <class Lcd>
+class LcdWidget {
+protected:
+	enum cells: uint8_t {
+		blankCell = ' ',
+		fullCell = 0xFF		// solid block in the character ROM
+	};
+	// the content of a special character is not known
+	enum glyphs: uint8_t {
+		unknownGlyph = 0xFF
+	};
+
+	LcdWidget(Lcd &lcd) : _lcd(lcd) {
+		_drawn = false;
+	}
+	void _begin() {
+		_lcd.beginBatch();
+		_col = 0xFF;
+	}
+	void _end() {
+		_lcd.endBatch();
+		_drawn = true;
+	}
+	void _put(uint8_t col, uint8_t row, uint8_t c) {
+		if (col != _col || row != _row)
+			_lcd.setCursor(col, row);
+		_lcd.write(c);
+		_col = col + 1;
+		_row = row;
+	}
+
+	Lcd &_lcd;
+	// false until the first update and after redraw
+	bool _drawn;
+private:
+	// where the cursor of the display is after the last _put
+	uint8_t _col;
+	uint8_t _row;
+};
+
+/*
+ * A bar growing to the right with a resolution of 5 pixels per cell,
+ * uses one special character for the partly filled cell
+ */
+template <class Lcd>
+class LcdHorizontalBar: public LcdWidget<Lcd> {
+public:
+	LcdHorizontalBar(Lcd &lcd, uint8_t slot, uint8_t col, uint8_t row,
+			uint8_t width);
+	void set(uint8_t pixels);
+	uint8_t maximum();
+	void redraw();
+private:
+	uint8_t _cell(uint8_t pixels, uint8_t n);
+	uint8_t _slot;
+	uint8_t _col;
+	uint8_t _row;
+	uint8_t _width;
+	uint8_t _pixels;
+	// pixels of the partly filled cell held by the special character
+	uint8_t _glyph;
+};
+
+/*
+ * A bar growing upwards from a bottom row with a resolution of 8 pixels
+ * per cell, uses one special character for the partly filled cell of
+ * which only the rows that change are sent
+ */
+template <class Lcd>
+class LcdVerticalBar: public LcdWidget<Lcd> {
+public:
+	LcdVerticalBar(Lcd &lcd, uint8_t slot, uint8_t col, uint8_t bottomRow,
+			uint8_t height);
+	void set(uint8_t pixels);
+	uint8_t maximum();
+	void redraw();
+private:
+	uint8_t _cell(uint8_t pixels, uint8_t n);
+	uint8_t _slot;
+	uint8_t _col;
+	uint8_t _bottomRow;
+	uint8_t _height;
+	uint8_t _pixels;
+	// pixels of the partly filled cell held by the special character
+	uint8_t _glyph;
+};
+
+/*
+ * Numbers of two rows high, each digit 3 columns wide followed by an
+ * empty column. Uses the three special characters slot, slot + 1 and
+ * slot + 2, so slot is at most 5, with a larger slot nothing is drawn.
+ * A value with more digits than the field shows as dashes.
+ */
+template <class Lcd, uint8_t digits>
+class LcdBigNumber: public LcdWidget<Lcd> {
+public:
+	LcdBigNumber(Lcd &lcd, uint8_t slot, uint8_t col, uint8_t row);
+	void set(uint32_t value);
+	void redraw();
+private:
+	enum font: uint8_t {
+		blankDigit = 10,
+		overflowDigit = 11,
+		unknownDigit = 0xFF
+	};
+	enum slots: uint8_t {
+		lastSlot = 5
+	};
+	uint8_t _code(uint8_t digit, uint8_t n);
+	static const uint8_t _font[12][6];
+	static const uint8_t _glyphs[3][8];
+	uint8_t _slot;
+	uint8_t _col;
+	uint8_t _row;
+	uint32_t _value;
+	uint8_t _shown[digits];
+};
+
+/*
+ * A number in a field of a fixed number of columns with a fixed number of
+ * decimals. Only the characters that differ from the previous value are
+ * sent. Formatted without Print, a value that doesn't fit shows as #.
+ */
+template <class Lcd, uint8_t width>
+class LcdNumberField: public LcdWidget<Lcd> {
+public:
+	enum alignments: uint8_t {
+		alRight,
+		alLeft
+	};
+	LcdNumberField(Lcd &lcd, uint8_t col, uint8_t row, uint8_t decimals = 0,
+			alignments alignment = alRight);
+	void set(int value);
+	void set(unsigned int value);
+	void set(long value);
+	void set(unsigned long value);
+	void set(long long value);
+	void set(unsigned long long value);
+	void set(double value);
+	void setScaled(int32_t value);
+	void redraw();
+private:
+	template <class T> void _setInteger(T value);
+	void _show(int32_t value, uint8_t fraction);
+	void _showOverflow();
+	void _send(const char *text);
+	uint8_t _col;
+	uint8_t _row;
+	uint8_t _decimals;
+	alignments _alignment;
+	char _shown[width];
+};
+
+// Number field----------------------------------------------------
+
+template <class Lcd, uint8_t width>
+LcdNumberField<Lcd, width>::LcdNumberField(Lcd& lcd, uint8_t col, uint8_t row,
+		uint8_t decimals, alignments alignment) : LcdWidget<Lcd>(lcd) {
+	_col = col;
+	_row = row;
+	_decimals = decimals > 9 ? 9 : decimals;
+	_alignment = alignment;
+}
+
+/*
+ * Shows an integer, followed by zeros for the decimals. There is an
+ * overload for every integer type, so any integer can be passed without
+ * being ambiguous with set(double). Values outside the range of int32_t
+ * show as #.
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(int value) {
+	_setInteger(value);
+}
+
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(unsigned int value) {
+	_setInteger(value);
+}
+
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(long value) {
+	_setInteger(value);
+}
+
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(unsigned long value) {
+	_setInteger(value);
+}
+
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(long long value) {
+	_setInteger(value);
+}
+
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(unsigned long long value) {
+	_setInteger(value);
+}
+
+/*
+ * Shows a value rounded to the decimals, a value out of range and NaN
+ * show as #
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::set(double value) {
+	for (uint8_t d = 0; d < _decimals; d++)
+		value *= 10;
+	value = value < 0 ? value - 0.5 : value + 0.5;
+	// also false for NaN
+	if (!(value > -2147483648.0 && value < 2147483648.0)) {
+		_showOverflow();
+		return;
+	}
+	_show(value, _decimals);
+}
+
+/*
+ * Shows a value given in units of the last decimal, e.g. 1234 with two
+ * decimals shows 12.34. Avoids floating point.
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::setScaled(int32_t value) {
+	_show(value, _decimals);
+}
+
+/*
+ * Draws the field completely on the next set
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::redraw() {
+	this->_drawn = false;
+}
+
+/*
+ * Helper function to show an integer of any type, the value must come
+ * back unchanged from int32_t
+ */
+template <class Lcd, uint8_t width>
+template <class T>
+void LcdNumberField<Lcd, width>::_setInteger(T value) {
+	int32_t converted = value;
+	if ((T) converted != value || (converted < 0) != (value < 0)) {
+		_showOverflow();
+		return;
+	}
+	_show(converted, 0);
+}
+
+/*
+ * Helper function to format a value of which the last fraction digits
+ * are decimals and send the characters that changed
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::_show(int32_t value, uint8_t fraction) {
+	// the characters from right to left
+	char digits[24];
+	uint8_t n = 0;
+	uint32_t magnitude = value < 0 ? 0UL - (uint32_t) value : value;
+	for (uint8_t d = fraction; d < _decimals; d++)
+		digits[n++] = '0';
+	for (uint8_t d = 0; d < fraction; d++) {
+		digits[n++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	}
+	if (_decimals)
+		digits[n++] = '.';
+	do {
+		digits[n++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0)
+		digits[n++] = '-';
+
+	char text[width];
+	if (n > width)
+		memset(text, '#', width);
+	else {
+		memset(text, ' ', width);
+		uint8_t start = _alignment == alRight ? width - n : 0;
+		for (uint8_t i = 0; i < n; i++)
+			text[start + i] = digits[n - 1 - i];
+	}
+	_send(text);
+}
+
+/*
+ * Helper function to fill the field with # for a value that doesn't fit
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::_showOverflow() {
+	char text[width];
+	memset(text, '#', width);
+	_send(text);
+}
+
+/*
+ * Helper function to send the characters of the field that changed
+ */
+template <class Lcd, uint8_t width>
+void LcdNumberField<Lcd, width>::_send(const char* text) {
+	if (this->_drawn && !memcmp(text, _shown, width))
+		return;
+	this->_begin();
+	for (uint8_t i = 0; i < width; i++)
+		if (!this->_drawn || text[i] != _shown[i])
+			this->_put(_col + i, _row, _shown[i] = text[i]);
+	this->_end();
+}
+
+// Horizontal bar--------------------------------------------------
+
+template <class Lcd>
+LcdHorizontalBar<Lcd>::LcdHorizontalBar(Lcd& lcd, uint8_t slot, uint8_t col,
+		uint8_t row, uint8_t width) : LcdWidget<Lcd>(lcd) {
+	_slot = slot & 0x7;
+	_col = col;
+	_row = row;
+	_width = width;
+	_pixels = 0;
+	_glyph = LcdWidget<Lcd>::unknownGlyph;
+}
+
+/*
+ * Sets the length of the bar in pixels, at most maximum()
+ */
+template <class Lcd>
+void LcdHorizontalBar<Lcd>::set(uint8_t pixels) {
+	if (pixels > maximum())
+		pixels = maximum();
+	if (this->_drawn && pixels == _pixels)
+		return;
+	this->_begin();
+	uint8_t part = pixels % 5;
+	if (part && part != _glyph) {
+		// the leftmost pixels of every row
+		uint8_t rows[8];
+		memset(rows, (0x1F << (5 - part)) & 0x1F, sizeof(rows));
+		this->_lcd.createChar(_slot, rows);
+		_glyph = part;
+	}
+	// only the cells between the old and new end can change
+	uint8_t first = 0;
+	uint8_t last = _width;
+	if (this->_drawn) {
+		first = (pixels < _pixels ? pixels : _pixels) / 5;
+		last = (pixels > _pixels ? pixels : _pixels) / 5 + 1;
+		if (last > _width)
+			last = _width;
+	}
+	for (uint8_t n = first; n < last; n++) {
+		uint8_t c = _cell(pixels, n);
+		if (!this->_drawn || c != _cell(_pixels, n))
+			this->_put(_col + n, _row, c);
+	}
+	_pixels = pixels;
+	this->_end();
+}
+
+/*
+ * Returns the length of the bar in pixels when completely filled
+ */
+template <class Lcd>
+uint8_t LcdHorizontalBar<Lcd>::maximum() {
+	return _width * 5;
+}
+
+/*
+ * Draws the bar completely on the next set
+ */
+template <class Lcd>
+void LcdHorizontalBar<Lcd>::redraw() {
+	this->_drawn = false;
+	_glyph = LcdWidget<Lcd>::unknownGlyph;
+}
+
+/*
+ * Helper function to return the character of cell n for a length
+ */
+template <class Lcd>
+uint8_t LcdHorizontalBar<Lcd>::_cell(uint8_t pixels, uint8_t n) {
+	if (n < pixels / 5)
+		return LcdWidget<Lcd>::fullCell;
+	if (n == pixels / 5 && pixels % 5)
+		return _slot;
+	return LcdWidget<Lcd>::blankCell;
+}
+
+// Vertical bar----------------------------------------------------
+
+template <class Lcd>
+LcdVerticalBar<Lcd>::LcdVerticalBar(Lcd& lcd, uint8_t slot, uint8_t col,
+		uint8_t bottomRow, uint8_t height) : LcdWidget<Lcd>(lcd) {
+	_slot = slot & 0x7;
+	_col = col;
+	_bottomRow = bottomRow;
+	_height = height;
+	_pixels = 0;
+	_glyph = LcdWidget<Lcd>::unknownGlyph;
+}
+
+/*
+ * Sets the height of the bar in pixels, at most maximum()
+ */
+template <class Lcd>
+void LcdVerticalBar<Lcd>::set(uint8_t pixels) {
+	static const uint8_t on[8] = {
+			0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F };
+	static const uint8_t off[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	if (pixels > maximum())
+		pixels = maximum();
+	if (this->_drawn && pixels == _pixels)
+		return;
+	this->_begin();
+	uint8_t part = pixels % 8;
+	if (part && part != _glyph) {
+		if (_glyph == LcdWidget<Lcd>::unknownGlyph) {
+			// the bottom rows are on
+			this->_lcd.updateChar(_slot, 0, off, 8 - part);
+			this->_lcd.updateChar(_slot, 8 - part, on, part);
+		} else if (part > _glyph)
+			this->_lcd.updateChar(_slot, 8 - part, on, part - _glyph);
+		else
+			this->_lcd.updateChar(_slot, 8 - _glyph, off, _glyph - part);
+		_glyph = part;
+	}
+	// only the cells between the old and new top can change
+	uint8_t first = 0;
+	uint8_t last = _height;
+	if (this->_drawn) {
+		first = (pixels < _pixels ? pixels : _pixels) / 8;
+		last = (pixels > _pixels ? pixels : _pixels) / 8 + 1;
+		if (last > _height)
+			last = _height;
+	}
+	for (uint8_t n = first; n < last; n++) {
+		uint8_t c = _cell(pixels, n);
+		if (!this->_drawn || c != _cell(_pixels, n))
+			this->_put(_col, _bottomRow - n, c);
+	}
+	_pixels = pixels;
+	this->_end();
+}
+
+/*
+ * Returns the height of the bar in pixels when completely filled
+ */
+template <class Lcd>
+uint8_t LcdVerticalBar<Lcd>::maximum() {
+	return _height * 8;
+}
+
+/*
+ * Draws the bar completely on the next set
+ */
+template <class Lcd>
+void LcdVerticalBar<Lcd>::redraw() {
+	this->_drawn = false;
+	_glyph = LcdWidget<Lcd>::unknownGlyph;
+}
+
+/*
+ * Helper function to return the character of cell n from the bottom
+ */
+template <class Lcd>
+uint8_t LcdVerticalBar<Lcd>::_cell(uint8_t pixels, uint8_t n) {
+	if (n < pixels / 8)
+		return LcdWidget<Lcd>::fullCell;
+	if (n == pixels / 8 && pixels % 8)
+		return _slot;
+	return LcdWidget<Lcd>::blankCell;
+}
+
+// Big number------------------------------------------------------
+
+/*
+ * The cells of the digits 0 to 9 and blank, top row left to right and
+ * then the bottom row: 0 blank, 1 full, 2 top bar, 3 bottom bar, 4 both
+ */
+template <class Lcd, uint8_t digits>
+const uint8_t LcdBigNumber<Lcd, digits>::_font[12][6] PROGMEM = {
+		{ 1, 2, 1, 1, 3, 1 },	// 0
+		{ 2, 1, 0, 3, 1, 3 },	// 1
+		{ 4, 4, 1, 1, 3, 3 },	// 2
+		{ 4, 4, 1, 3, 3, 1 },	// 3
+		{ 1, 3, 1, 0, 0, 1 },	// 4
+		{ 1, 4, 4, 3, 3, 1 },	// 5
+		{ 1, 4, 4, 1, 3, 1 },	// 6
+		{ 2, 2, 1, 0, 0, 1 },	// 7
+		{ 1, 4, 1, 1, 3, 1 },	// 8
+		{ 1, 4, 1, 3, 3, 1 },	// 9
+		{ 0, 0, 0, 0, 0, 0 },	// blank
+		{ 3, 3, 3, 2, 2, 2 }	// dash for overflow
+};
+
+// top bar, bottom bar and both
+template <class Lcd, uint8_t digits>
+const uint8_t LcdBigNumber<Lcd, digits>::_glyphs[3][8] PROGMEM = {
+		{ 0x1F, 0x1F, 0x1F, 0, 0, 0, 0, 0 },
+		{ 0, 0, 0, 0, 0, 0x1F, 0x1F, 0x1F },
+		{ 0x1F, 0x1F, 0x1F, 0, 0, 0x1F, 0x1F, 0x1F }
+};
+
+template <class Lcd, uint8_t digits>
+LcdBigNumber<Lcd, digits>::LcdBigNumber(Lcd& lcd, uint8_t slot, uint8_t col,
+		uint8_t row) : LcdWidget<Lcd>(lcd) {
+	_slot = slot;
+	_col = col;
+	_row = row;
+}
+
+/*
+ * Shows a value right aligned, a value that doesn't fit shows a dash
+ * in every digit
+ */
+template <class Lcd, uint8_t digits>
+void LcdBigNumber<Lcd, digits>::set(uint32_t value) {
+	if (_slot > lastSlot || (this->_drawn && value == _value))
+		return;
+	_value = value;
+	uint32_t rest = value;
+	for (uint8_t d = 0; d < digits && rest; d++)
+		rest /= 10;
+	bool overflow = rest;
+	this->_begin();
+	if (!this->_drawn) {
+		for (uint8_t g = 0; g < 3; g++) {
+			uint8_t rows[8];
+			for (uint8_t n = 0; n < 8; n++)
+				rows[n] = pgm_read_byte(&_glyphs[g][n]);
+			this->_lcd.createChar(_slot + g, rows);
+		}
+		// the empty columns between the digits
+		for (uint8_t d = 0; d < digits; d++) {
+			this->_put(_col + d * 4 + 3, _row, LcdWidget<Lcd>::blankCell);
+			this->_put(_col + d * 4 + 3, _row + 1, LcdWidget<Lcd>::blankCell);
+		}
+		memset(_shown, unknownDigit, digits);
+	}
+	for (uint8_t d = digits; d-- > 0;) {
+		uint8_t digit = value % 10;
+		if (!value && d != digits - 1)
+			digit = blankDigit;
+		if (overflow)
+			digit = overflowDigit;
+		value /= 10;
+		if (digit == _shown[d])
+			continue;
+		uint8_t col = _col + d * 4;
+		for (uint8_t n = 0; n < 6; n++) {
+			uint8_t c = _code(digit, n);
+			if (_shown[d] == unknownDigit || c != _code(_shown[d], n))
+				this->_put(col + n % 3, _row + n / 3, c);
+		}
+		_shown[d] = digit;
+	}
+	this->_end();
+}
+
+/*
+ * Draws the number completely on the next set
+ */
+template <class Lcd, uint8_t digits>
+void LcdBigNumber<Lcd, digits>::redraw() {
+	this->_drawn = false;
+}
+
+/*
+ * Helper function to return the character of cell n of a digit
+ */
+template <class Lcd, uint8_t digits>
+uint8_t LcdBigNumber<Lcd, digits>::_code(uint8_t digit, uint8_t n) {
+	uint8_t cell = pgm_read_byte(&_font[digit][n]);
+	if (cell == 0)
+		return LcdWidget<Lcd>::blankCell;
+	if (cell == 1)
+		return LcdWidget<Lcd>::fullCell;
+	return _slot + cell - 2;
+}
+
+#endif // LcdWidgets_H
@@ -0,0 +1,96 @@
+/*
+ * Updates several RgbLcdKeyShieldI2C displays on the same bus
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef RgbLcdGroup_H
+#define RgbLcdGroup_H
+
+#include "RgbLcdKeyShieldI2C.h"
+
+/*
+ * Each display gets its own address with the A0, A1 and A2 jumpers of the
+ * MCP23017 and is given to the constructor:
+ *
+ *   RgbLcdKeyShieldI2C lcd0(false, RgbLcdKeyShieldI2C::defaultAddress);
+ *   RgbLcdKeyShieldI2C lcd1(false, RgbLcdKeyShieldI2C::defaultAddress + 1);
+ *   RgbLcdGroup<RgbLcdKeyShieldI2C> group;
+ *
+ * The displays use a frame buffer, a queue or both. update sends what is
+ * pending for all displays in one pass, each display in its own
+ * transmission exactly as flush and poll of a single display do.
+ */
+template <class Lcd, uint8_t maxDisplays = 8>
+class RgbLcdGroup {
+public:
+	RgbLcdGroup();
+	bool add(Lcd &lcd);
+	void update(bool wait = true);
+private:
+	static_assert(maxDisplays <= 8, "at most 8 displays on one bus");
+	Lcd *_lcds[maxDisplays];
+	uint8_t _count;
+};
+
+template <class Lcd, uint8_t maxDisplays>
+RgbLcdGroup<Lcd, maxDisplays>::RgbLcdGroup() {
+	_count = 0;
+}
+
+/*
+ * Adds a display to the group, returns false when the group is full
+ */
+template <class Lcd, uint8_t maxDisplays>
+bool RgbLcdGroup<Lcd, maxDisplays>::add(Lcd& lcd) {
+	if (_count == maxDisplays)
+		return false;
+	_lcds[_count++] = &lcd;
+	return true;
+}
+
+/*
+ * Flushes the frame buffer and sends the queue of all displays. The
+ * displays that are ready go first, so while one display executes a slow
+ * instruction like clear the bus is used for the others. When wait is true
+ * update returns when everything is sent, the busy displays are continued
+ * as soon as they become ready. Otherwise what is left is sent by the next
+ * update.
+ */
+template <class Lcd, uint8_t maxDisplays>
+void RgbLcdGroup<Lcd, maxDisplays>::update(bool wait) {
+	uint8_t pending = (1 << _count) - 1;
+	uint8_t unflushed = pending;
+	do {
+		for (uint8_t i = 0; i < _count; i++) {
+			if (!(pending & (1 << i)) || !_lcds[i]->isReady())
+				continue;
+			if (unflushed & (1 << i)) {
+				_lcds[i]->flush();
+				unflushed &= ~(1 << i);
+			}
+			// poll stops at a slow instruction and at a color change
+			while (!_lcds[i]->flushed() && _lcds[i]->isReady())
+				_lcds[i]->poll(0xFF);
+			if (_lcds[i]->flushed())
+				pending &= ~(1 << i);
+		}
+	} while (wait && pending);
+}
+
+#endif // RgbLcdGroup_H
@@ -23,6 +23,11 @@
  */
 /*
  * version
+ * 0.1.3	2026/10/16 padding between instructions on fast buses
+ * 0.1.2	2026/10/16 bus access as template parameter, Wire on other architectures
+ * 0.1.1	2026/10/16 geometry of the display as template parameter, line wrap
+ * 0.1.0	2026/10/16 the shield is a template over the wiring of the MCP23017
+ * 0.0.4	2026/10/16 introduced frame buffer and software cursor tracking
  * 0.0.3	2021/03/08 introduced inverted backlight option
  * 0.0.2	2017/07/11 introduced read and getCursor for the lcd
  * 0.0.1	2017/07/04 initial version
@@ -32,12 +37,200 @@
 #define RgbLcdKeyShieldI2C_H
 
 #include "Arduino.h"
-#include "I2C.h"
+#include "RgbLcdTransport.h"
+
+#ifdef RGBLCD_STATS
+/*
+ * Counters of the bus traffic and the time spent in the library, only
+ * compiled when RGBLCD_STATS is defined before including this file.
+ * Everything is attributed to the public function that was called, the
+ * time includes the delays. Takes about 300 bytes of RAM.
+ */
+class LcdStats {
+public:
+	// the public functions grouped by what they do
+	enum entryPoints: uint8_t {
+		epOther,		// not attributed, only bus traffic is counted
+		epBegin,
+		epClear,
+		epHome,
+		epCursor,		// setCursor, moveCursorLeft and moveCursorRight
+		epControl,		// display on/off, cursor, blink, scroll and entry mode
+		epColor,
+		epCreateChar,
+		epWrite,		// write, print, printP and writeP
+		epRead,			// read and readScreen
+		epBatch,		// beginBatch and endBatch
+		epFlush,
+		epPoll,
+		epReadKeys,
+		epCount
+	};
+	struct Counters {
+		uint32_t calls;
+		uint32_t transactions;	// STARTs including repeated STARTs
+		uint32_t bytesWritten;	// including the address bytes
+		uint32_t bytesRead;
+		uint32_t delayMicros;	// delays and waits for slow instructions
+		uint32_t micros;		// time spent in the entry point
+	};
+	Counters counters[epCount];
+
+	LcdStats() {
+		reset();
+	}
+	void reset() {
+		memset(counters, 0, sizeof(counters));
+		_current = epOther;
+	}
+	// the sum of all entry points
+	Counters total() const {
+		Counters sum;
+		memset(&sum, 0, sizeof(sum));
+		for (uint8_t i = 0; i < epCount; i++) {
+			sum.calls += counters[i].calls;
+			sum.transactions += counters[i].transactions;
+			sum.bytesWritten += counters[i].bytesWritten;
+			sum.bytesRead += counters[i].bytesRead;
+			sum.delayMicros += counters[i].delayMicros;
+			sum.micros += counters[i].micros;
+		}
+		return sum;
+	}
+	void start() {
+		counters[_current].transactions++;
+	}
+	void written(uint8_t bytes) {
+		counters[_current].bytesWritten += bytes;
+	}
+	void read(uint8_t bytes) {
+		counters[_current].bytesRead += bytes;
+	}
+	// write of a register
+	void registerWritten() {
+		start();
+		written(3);
+	}
+	// read of a register, with a repeated start
+	void registerRead(uint8_t bytes) {
+		start();
+		start();
+		written(3);
+		read(bytes);
+	}
+	void delayed(uint32_t us) {
+		counters[_current].delayMicros += us;
+	}
+	// counts the time left until the deadline
+	void waitUntil(uint32_t deadline) {
+		int32_t left = deadline - ::micros();
+		if (left > 0)
+			delayed(left);
+	}
+
+	/*
+	 * Attributes everything until it goes out of scope to an entry point,
+	 * nested public calls are attributed to the outer one
+	 */
+	class Entry {
+	public:
+		Entry(LcdStats &stats, entryPoints entryPoint) : _stats(stats), _start(0) {
+			_outer = stats._current == epOther;
+			if (_outer) {
+				stats._current = entryPoint;
+				_start = ::micros();
+			}
+		}
+		~Entry() {
+			if (!_outer)
+				return;
+			Counters &counters = _stats.counters[_stats._current];
+			counters.calls++;
+			counters.micros += ::micros() - _start;
+			_stats._current = epOther;
+		}
+	private:
+		LcdStats &_stats;
+		uint32_t _start;
+		bool _outer;
+	};
+
+private:
+	uint8_t _current;
+};
+
+#define RGBLCD_STAT_ENTRY(entryPoint) \
+	LcdStats::Entry _statEntry(_stats, LcdStats::entryPoint)
+#define RGBLCD_STAT_START() _stats.start()
+#define RGBLCD_STAT_WRITE(bytes) _stats.written(bytes)
+#define RGBLCD_STAT_REGISTER() _stats.registerWritten()
+#define RGBLCD_STAT_REGISTER_READ(bytes) _stats.registerRead(bytes)
+#define RGBLCD_STAT_READ(bytes) _stats.read(bytes)
+#define RGBLCD_STAT_DELAY(us) _stats.delayed(us)
+#define RGBLCD_STAT_WAIT(deadline) _stats.waitUntil(deadline)
+#else
+#define RGBLCD_STAT_ENTRY(entryPoint)
+#define RGBLCD_STAT_START()
+#define RGBLCD_STAT_WRITE(bytes)
+#define RGBLCD_STAT_REGISTER()
+#define RGBLCD_STAT_REGISTER_READ(bytes)
+#define RGBLCD_STAT_READ(bytes)
+#define RGBLCD_STAT_DELAY(us)
+#define RGBLCD_STAT_WAIT(deadline)
+#endif // RGBLCD_STATS
+
+/*
+ * Timing of the key handler in milliseconds, at most 65535. A struct like
+ * this one can be passed to RgbLcdKeyShieldI2CT for other timings.
+ */
+struct DefaultKeyTiming {
+	enum keyTime: uint16_t {
+		debounce = 50,
+		longPress = 500,
+		repeatInterval = 250
+	};
+};
+
+/*
+ * A key event as stored in the event queue of the shield
+ */
+struct KeyEvent {
+	// the keys, independent of the wiring
+	enum keyMasks: uint8_t {
+		kmSelect = 0x01,
+		kmRight = 0x02,
+		kmDown = 0x04,
+		kmUp = 0x08,
+		kmLeft = 0x10
+	};
+	// the event types, also used as flags returned by SimpleKeyHandler::read
+	enum types: uint8_t {
+		evPress = 0x01,			// key pressed after debounce
+		evShortPress = 0x02,	// released before the long press time expired
+		evLongPress = 0x04,		// long press time expired
+		evRepPress = 0x08,		// repeat, count holds the repeat count
+		evTwoPress = 0x10,		// count holds the mask of the other key
+		evRelease = 0x20,		// key released after debounce
+		evChord = 0x40			// keys holds all keys pressed together
+	};
+	uint8_t keys;
+	uint8_t type;
+	uint16_t count;
+	uint32_t time;
+};
+
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+class RgbLcdKeyShieldI2CT;
 
 class SimpleKeyHandler {
+	template <class Wiring, class KeyTiming, class Geometry, class Transport>
+	friend class RgbLcdKeyShieldI2CT;
 public:
 	SimpleKeyHandler();
 	void read(bool keyState);
+	template <class Timing>
+	uint8_t read(bool keyState, uint32_t now);
+	void dispatch(uint8_t events, uint16_t count, const SimpleKeyHandler* otherKey);
 	void clear();
 	bool isPressed();
 	// Called when the key is released before the long press time expired.
@@ -51,22 +244,128 @@ public:
 	// Called when two keys are pressed at the same time
 	static void (*onTwoPress)(const SimpleKeyHandler* senderKey, const SimpleKeyHandler* otherKey);
 private:
-	enum lastKeyState {
+	enum lastKeyState: uint8_t {
 		keyOff, keyToOn, keyOn, keyToOff
-	} _previousState;
-	enum keyTime {
-		debounce = 50,
-		longPress = 500,
-		repeatInterval = 250
 	};
-	uint32_t _nextValidRead;
-	bool _allowEvents;
+	// next state for a released and a pressed key
+	static const uint8_t _transitions[4][2];
+	// packed in one byte to keep the keys small
+	uint8_t _state: 2;
+	uint8_t _allowEvents: 1;
+	uint8_t _repeating: 1;
+	// lower 16 bits of millis() at the last transition
+	uint16_t _stamp;
 	static uint16_t _count;
 	static SimpleKeyHandler* _activeKey;
 	static SimpleKeyHandler* _otherKey;
+	uint8_t _enter(uint8_t state, uint16_t now);
+	uint8_t _expired();
+	uint8_t _stillOn();
+};
+
+/*
+ * To be placed in the main loop. Expect TRUE if a key is pressed, now is
+ * the time in milliseconds so more keys can share one call of millis().
+ * The elapsed time is calculated with unsigned 16 bit arithmetic so the
+ * rollover of millis() does no harm.
+ * Returns the KeyEvent types that occurred, the callbacks are not called.
+ */
+template <class Timing>
+inline uint8_t SimpleKeyHandler::read(bool keyState, uint32_t now) {
+	uint16_t elapsed = (uint16_t) now - _stamp;
+	// ignore the key in the transitional states until debounce time expired
+	if ((_state == keyToOn || _state == keyToOff) && elapsed < Timing::debounce)
+		return 0;
+	uint8_t state = _transitions[_state][keyState];
+	if (state != _state)
+		return _enter(state, now);
+	if (_state == keyOn) {
+		// events after long press and repeat after the repeat interval
+		if (elapsed >= (_repeating ? Timing::repeatInterval : Timing::longPress)) {
+			_stamp = now;
+			_repeating = true;
+			return _expired();
+		}
+		return _stillOn();
+	}
+	return 0;
+}
+
+/*
+ * Describes how the MCP23017 is wired to the lcd, the leds of the backlight
+ * and the keys. The lcd must be connected to port B and the keys to port A,
+ * the numbers are the bit numbers of the port. The leds are numbered 0 to 7
+ * for GPA0 to GPA7 and 8 to 15 for GPB0 to GPB7 and are on when low.
+ * Clone shields with another pinout get their own struct like this one.
+ * The key timing is the optional second template parameter.
+ */
+struct AdafruitWiring {
+	enum lcd: uint8_t {
+		db4 = 4,
+		db5 = 3,
+		db6 = 2,
+		db7 = 1,
+		rs = 7,
+		rw = 6,
+		e = 5
+	};
+	enum leds: uint8_t {
+		red = 6,
+		green = 7,
+		blue = 8
+	};
+	enum keys: uint8_t {
+		select = 0,
+		right = 1,
+		down = 2,
+		up = 3,
+		left = 4
+	};
+};
+
+/*
+ * Geometries of the display, the optional third template parameter.
+ * Displays with four rows continue the first row in the third row and
+ * the second row in the fourth row of DDRAM.
+ */
+struct Lcd16x2 {
+	enum size: uint8_t {
+		columns = 16,
+		rows = 2
+	};
+};
+
+struct Lcd20x2 {
+	enum size: uint8_t {
+		columns = 20,
+		rows = 2
+	};
 };
 
-class RgbLcdKeyShieldI2C: public Print {
+struct Lcd40x2 {
+	enum size: uint8_t {
+		columns = 40,
+		rows = 2
+	};
+};
+
+struct Lcd16x4 {
+	enum size: uint8_t {
+		columns = 16,
+		rows = 4
+	};
+};
+
+struct Lcd20x4 {
+	enum size: uint8_t {
+		columns = 20,
+		rows = 4
+	};
+};
+
+template <class Wiring, class KeyTiming = DefaultKeyTiming,
+		class Geometry = Lcd16x2, class Transport = DefaultTransport>
+class RgbLcdKeyShieldI2CT: public Print {
 public:
 	enum colors: uint8_t {
 		clBlack = 0,
@@ -79,9 +378,46 @@ public:
 		clWhite = 7
 	};
 
+	// size of the display in characters
+	enum displaySize: uint8_t {
+		displayColumns = Geometry::columns,
+		displayRows = Geometry::rows
+	};
+
+	// size in bytes of the buffer needed by enableFrameBuffer and readScreen
+	enum frameBuffer: uint8_t {
+		frameBufferSize = 2 * Geometry::columns * Geometry::rows,
+		screenSize = Geometry::columns * Geometry::rows
+	};
+
+	// handling of the execution time of clear, home and begin
+	enum waitModes: uint8_t {
+		wmDelay,
+		wmDeadline,
+		wmBusyFlag
+	};
+
+	// what to do when the queue is full
+	enum overflowPolicies: uint8_t {
+		opBlock,
+		opDrop,
+		opCoalesce
+	};
+
+	// for setKeyInterrupt when INTA is not connected
+	enum keyInterrupt: uint8_t {
+		noInterruptPin = 0xFF
+	};
+
+	// address of the MCP23017 with A0, A1 and A2 low, up to 0x27
+	enum i2cAddress: uint8_t {
+		defaultAddress = 0x20
+	};
+
 	using Print::write; // pull in write(str) and write(buf, size) from Print
 
-	RgbLcdKeyShieldI2C(bool invertedBacklight = false);
+	RgbLcdKeyShieldI2CT(bool invertedBacklight = false,
+			uint8_t address = defaultAddress);
 
 	void begin();
 	void clear();
@@ -102,7 +438,11 @@ public:
 	void moveCursorLeft();
 	void autoscroll();
 	void noAutoscroll();
+	void lineWrap();
+	void noLineWrap();
 	void createChar(uint8_t location, const uint8_t *charmap);
+	void updateChar(uint8_t location, uint8_t first, const uint8_t *rows,
+			uint8_t count);
 #ifdef __AVR__
 	void createCharP(uint8_t location, const uint8_t *charmap);
 	size_t printP(const char str[]);
@@ -112,10 +452,41 @@ public:
 	size_t write(const uint8_t *buffer, size_t size) override;
 	uint8_t read();
 	size_t read(uint8_t *buffer, size_t size);
+	size_t readScreen(uint8_t *buffer);
 	uint8_t getCursor();
 
+	void setWaitMode(waitModes mode);
+	void setBusClock(uint32_t hz);
+	bool isReady();
+
+	bool enableQueue(uint8_t *buffer, uint8_t size,
+			overflowPolicies policy = opBlock);
+	void disableQueue();
+	void poll(uint8_t maxBytes = 16);
+	void service(uint16_t budget);
+	bool flushed();
+
+	void beginBatch();
+	void endBatch();
+
+	void enableFrameBuffer(uint8_t *buffer);
+	void disableFrameBuffer();
+	void flush();
+	void invalidate();
+	uint8_t scrub(uint8_t cells = 4, bool reinitialize = true);
+
+	void setKeyInterrupt(uint8_t pin, uint16_t fallbackInterval = 1000);
+	void enableKeyEvents(KeyEvent *buffer, uint8_t size);
+	void disableKeyEvents();
+	bool readKeyEvent(KeyEvent &event);
+	void dispatchKeyEvent(const KeyEvent &event);
+	void dispatchKeyEvents();
 	void readKeys();
 	void clearKeys();
+#ifdef RGBLCD_STATS
+	const LcdStats& stats() const;
+	void resetStats();
+#endif // RGBLCD_STATS
 	SimpleKeyHandler keyLeft;
 	SimpleKeyHandler keyRight;
 	SimpleKeyHandler keyUp;
@@ -124,14 +495,16 @@ public:
 private:
 	// 8 bit mode MCP23017 register addresses
 	enum MCP23017 {
-		I2Caddr = 0x20,
 		IOCON = 0x0b,
 		IODIRA = 0x00,
 		IPOLA = 0x01,
 		IODIRB = 0x10,
 		GPIOA = 0x09,
 		GPIOB = 0x19,
-		GPPUA = 0x06
+		GPPUA = 0x06,
+		GPINTENA = 0x02,
+		DEFVALA = 0x03,
+		INTCONA = 0x04
 	};
 
 	// HD44780 constants
@@ -158,7 +531,62 @@ private:
 		// flags for function set
 		bitMode8Flag = 0x10, // 8 bit = 1, 4 bit = 0
 		lineMode2Flag = 0x08, // 2 line = 1, 1 line = 0
-		dots5x10Flag = 0x04 // 5x10 dots = 1, 5x8 dots = 0
+		dots5x10Flag = 0x04, // 5x10 dots = 1, 5x8 dots = 0
+		// busy flag read together with the address counter
+		busyFlag = 0x80
+	};
+
+	// execution times in microseconds, a data write includes the 4 us
+	// until the address counter is updated
+	enum lcdTiming: uint8_t {
+		instructionMicros = 41,
+		initMicros = 100
+	};
+
+	// display geometry
+	enum geometry: uint8_t {
+		columns = Geometry::columns,
+		rows = Geometry::rows,
+		rowOffset = 0x40,
+		columnsPerLine = 40,
+		frameCells = columns * rows
+	};
+	static_assert((rows == 2 || rows == 4) && columns * (rows / 2) <= columnsPerLine,
+			"the rows must fit in the two DDRAM lines");
+
+	// DDRAM address of the first column of a row
+	static constexpr uint8_t _rowAddress(uint8_t row) {
+		return (row & 1 ? rowOffset : 0) + (row >> 1) * columns;
+	}
+
+	// pin masks derived from the wiring
+	enum pinMasks: uint8_t {
+		rsPin = 1 << Wiring::rs,
+		rwPin = 1 << Wiring::rw,
+		ePin = 1 << Wiring::e,
+		dataPins = 1 << Wiring::db4 | 1 << Wiring::db5 | 1 << Wiring::db6
+				| 1 << Wiring::db7,
+		lcdPins = rsPin | rwPin | ePin | dataPins,
+		ledPinsA = (Wiring::red < 8 ? 1 << Wiring::red : 0)
+				| (Wiring::green < 8 ? 1 << Wiring::green : 0)
+				| (Wiring::blue < 8 ? 1 << Wiring::blue : 0),
+		ledPinsB = (Wiring::red < 8 ? 0 : 1 << (Wiring::red - 8))
+				| (Wiring::green < 8 ? 0 : 1 << (Wiring::green - 8))
+				| (Wiring::blue < 8 ? 0 : 1 << (Wiring::blue - 8)),
+		keyPins = 1 << Wiring::select | 1 << Wiring::right | 1 << Wiring::down
+				| 1 << Wiring::up | 1 << Wiring::left
+	};
+	static_assert(!(ledPinsB & lcdPins), "a led shares a pin with the lcd");
+	static_assert(!(ledPinsA & keyPins), "a led shares a pin with a key");
+
+	/*
+	 * marks a slow instruction, followed by its execution time in ms, and
+	 * a value for GPIOA in the queue, R/W is only set while reading and
+	 * cleared after it so these can't be pin values
+	 */
+	enum queueMarker: uint8_t {
+		queueSlowMarker = rwPin,
+		queuePortAMarker = rwPin | rsPin
 	};
 
 	// shadow registers  MCP23017 GPIOA and GPIOB
@@ -169,14 +597,124 @@ private:
 	int8_t _shadowDisplayControl;
 	int8_t _shadowEntryModeSet;
 
+	// shadow of the DDRAM address counter of the HD44780
+	uint8_t _addressCounter;
+
 	// translation table from nibble to pin
 	static const uint8_t _nibbleToPin[16];
 
+	// pins for a nibble with RS and E set, used to generate _nibbleToPin
+	static constexpr uint8_t _nibblePins(uint8_t nibble) {
+		return rsPin | ePin
+				| (nibble & 0x1 ? 1 << Wiring::db4 : 0)
+				| (nibble & 0x2 ? 1 << Wiring::db5 : 0)
+				| (nibble & 0x4 ? 1 << Wiring::db6 : 0)
+				| (nibble & 0x8 ? 1 << Wiring::db7 : 0);
+	}
+
 	bool _invertedBacklight;
+	uint8_t _address;
+	// continue on the next row at the end of a row
+	bool _lineWrap;
+
+	// execution time of slow instructions
+	waitModes _waitMode;
+	bool _busy;
+	uint32_t _readyAt;
+
+	// bus clock in Hz, 0 when unknown and nothing is padded
+	uint32_t _busClock;
+	// dummy bytes after every instruction and those still to be sent
+	uint8_t _padBytes;
+	uint8_t _padOwed;
+
+	// ring buffer of pin values for GPIOB
+	uint8_t *_queue;
+	uint8_t _queueSize;
+	uint8_t _queueHead;
+	uint8_t _queueTail;
+	uint8_t _queueCount;
+	overflowPolicies _overflowPolicy;
+
+	// interrupt driven reading of the keys
+	bool _keyPolled;
+	uint8_t _keyPin;
+	uint8_t _keyState;
+	uint16_t _keyInterval;
+	uint32_t _keyReadTime;
+
+	// ring buffer of key events
+	KeyEvent *_keyEvents;
+	uint8_t _keyEventSize;
+	uint8_t _keyEventHead;
+	uint8_t _keyEventCount;
+	// keys of the chord being pressed and if it was reported, the last
+	// mask read and the lower 16 bits of millis() when it changed
+	uint8_t _chordKeys;
+	bool _chordReported;
+	uint8_t _chordRaw;
+	uint16_t _chordStamp;
+
+	// nesting depth of beginBatch, the transmission is open when not 0
+	uint8_t _batchDepth;
+
+#ifdef RGBLCD_STATS
+	LcdStats _stats;
+#endif // RGBLCD_STATS
+
+	// frame buffer, the first half holds what the application wrote,
+	// the second half what the display is showing
+	uint8_t *_frame;
+	uint8_t _frameCol;
+	uint8_t _frameRow;
+	// false if the content of the display is unknown
+	bool _frameValid;
+	// next cell to be checked by scrub, and true while it writes the
+	// frame back after an initialization
+	uint8_t _scrubCell;
+	bool _scrubRewrite;
+	enum scrubSize: uint8_t {
+		maxScrubCells = 8
+	};
+
+	inline void _writeLed(uint8_t led, bool value);
+	inline void _advanceCursor();
+	inline void _advanceWrite();
+	void _wrapLine();
+	void _stepAddress(bool increment);
+	inline void _readKey(SimpleKeyHandler &key, uint8_t mask, bool keyState,
+			uint32_t now);
+	void _pushKeyEvent(uint8_t keys, uint8_t type, uint16_t count, uint32_t time);
+	void _detectChord(uint8_t pressed, uint32_t now);
+	SimpleKeyHandler* _keyOf(uint8_t mask);
+	uint8_t _maskOf(const SimpleKeyHandler *key);
+	void _frameWrite(uint8_t c);
+	void _flushOpen(uint8_t flushModeSet);
 
 	void _lcdWrite4(uint8_t value, bool lcdInstruction);
+	uint8_t _padding(uint8_t us);
+	inline void _pad();
+	inline void _nibbleToShadow(uint8_t value, bool lcdInstruction);
 	inline void _lcdWrite8(uint8_t value, bool lcdInstruction);
 	void _lcdTransmit(uint8_t value, bool lcdInstruction);
+	void _beginTransmission();
+	void _endTransmission();
+	void _queueWrite8(uint8_t value, bool lcdInstruction);
+	inline void _enqueue(uint8_t pins);
+	void _queueReserve(uint8_t bytes);
+	inline bool _queueDrops();
+	inline uint8_t _dequeue();
+	void _drainQueue(uint8_t maxBytes, bool wait, uint32_t start = 0,
+			uint16_t budget = 0);
+	void _flushQueue();
+	void _setBusy(uint8_t ms);
+	void _setupPorts();
+	void _setupLcd();
+	void _reinitialize();
+	void _waitReady();
+	void _waitDeadline();
+	void _suspendBatch();
+	void _resumeBatch();
 	void _prepareRead(bool lcdInstruction);
 	uint8_t _lcdRead4();
 	inline uint8_t _lcdRead8();
@@ -185,5 +723,10 @@ private:
 
 
 
+#include "RgbLcdKeyShieldI2CImpl.h"
+
+// the Adafruit RGB LCD Shield Kit and the RobotDyn LCD RGB 16x2 share the wiring
+typedef RgbLcdKeyShieldI2CT<AdafruitWiring> RgbLcdKeyShieldI2C;
+
 #endif //  RgbLcdKeyShieldI2C_H
 
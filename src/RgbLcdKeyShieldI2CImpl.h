@@ -0,0 +1,1849 @@
+/*
+ * This is a library for the Adafruit RGB LCD Shield Kit and the
+ * RobotDyn LCD RGB 16x2 + keypad + Buzzer Shield for Arduino
+ *
+ * Implementation of the RgbLcdKeyShieldI2CT template, included
+ * by RgbLcdKeyShieldI2C.h
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef RgbLcdKeyShieldI2CImpl_H
+#define RgbLcdKeyShieldI2CImpl_H
+
+//--------------------------------RgbLcdKeyShield----------------------------
+
+/*
+ * Translation from nibble to pins, generated from the wiring at compile
+ * time. A 16 byte lookup table is the fastest way to translate the often
+ * scrambled data lines. Additionally:
+ * RS (register select) is set as most traffic is to the data register
+ * R/W is set low as this is a write operation
+ * E is set high
+ *
+ * The table is defined as static so that it is compiled only once
+ * when more instances of this class are created.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+#ifdef __AVR__
+	const uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_nibbleToPin[16] PROGMEM = {
+#else
+	const uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_nibbleToPin[16] = {
+#endif // __AVR__
+			_nibblePins(0),	// 0000
+			_nibblePins(1),	// 0001
+			_nibblePins(2),	// 0010
+			_nibblePins(3),	// 0011
+			_nibblePins(4),	// 0100
+			_nibblePins(5),	// 0101
+			_nibblePins(6),	// 0110
+			_nibblePins(7),	// 0111
+			_nibblePins(8),	// 1000
+			_nibblePins(9),	// 1001
+			_nibblePins(10),	// 1010
+			_nibblePins(11),	// 1011
+			_nibblePins(12),	// 1100
+			_nibblePins(13),	// 1101
+			_nibblePins(14),	// 1110
+			_nibblePins(15)	// 1111
+			};
+
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::RgbLcdKeyShieldI2CT(bool invertedBacklight,
+		uint8_t address) {
+	_shadowGPIOA = ledPinsA; // set the leds high (off)
+	_shadowGPIOB = ledPinsB | ePin; // set the leds and lcd enable high
+	_shadowDisplayControl = displayControl | displayOnFlag; // set on, no cursor and no blinking
+	_shadowEntryModeSet = entryModeSet | left2RightFlag; // left to right, no shift
+	_addressCounter = 0;
+	_invertedBacklight = invertedBacklight;
+	_address = address;
+	_lineWrap = false;
+	_frame = nullptr;
+	_scrubCell = 0;
+	_scrubRewrite = false;
+	_batchDepth = 0;
+	_waitMode = wmDelay;
+	_busy = false;
+	_busClock = 0;
+	_padBytes = 0;
+	_padOwed = 0;
+	_queue = nullptr;
+	_keyPolled = true;
+	_keyPin = noInterruptPin;
+	_keyInterval = 1000;
+	_keyReadTime = 0;
+	_keyState = 0;
+	_keyEvents = nullptr;
+}
+
+/*
+ * initialize the MCP23017 and the LCD
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::begin() {
+	RGBLCD_STAT_ENTRY(epBegin);
+	// give the lcd some time to get ready
+	if (_waitMode == wmDelay) {
+		delay(100);
+		RGBLCD_STAT_DELAY(100000UL);
+	}
+	else if (millis() < 100) {
+		// only the part since the power up is left, the
+		// MCP23017 is set up meanwhile
+		_readyAt = micros() + (100 - millis()) * 1000UL;
+		_busy = true;
+	}
+	_setupPorts();
+	// read the keys at the first readKeys
+	_keyReadTime = millis() - _keyInterval;
+	_setupLcd();
+	// a frame buffer has to be written completely by the next flush
+	invalidate();
+}
+
+/*
+ * Helper function to set up the registers of the MCP23017
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_setupPorts() {
+	/*
+	 * Set the MCP23017 in 8 bit mode , sequential addressing
+	 * disabled and slew rate disabled by writing to
+	 * register 0x0b.
+	 * As this register is not present in 16 bit mode
+	 * we can safely write to it after a hot reset
+	 * of the controlling device as in this case the
+	 * MCP23017 is already in 8 bit mode which is possible
+	 * as the hardware reset of the device is not used.
+	 */
+	Transport::write(_address, IOCON, B10101000);
+	RGBLCD_STAT_REGISTER();
+	// set the leds on port A high
+	Transport::write(_address, GPIOA, _shadowGPIOA);
+	RGBLCD_STAT_REGISTER();
+	// make the led pins outputs
+	Transport::write(_address, IODIRA, (uint8_t) ~ledPinsA);
+	RGBLCD_STAT_REGISTER();
+	// enable pull-ups on input pins
+	Transport::write(_address, GPPUA, (uint8_t) ~ledPinsA);
+	RGBLCD_STAT_REGISTER();
+	// set the leds on port B and lcd enable high
+	Transport::write(_address, GPIOB, _shadowGPIOB);
+	RGBLCD_STAT_REGISTER();
+	// set all to output
+	Transport::write(_address, IODIRB, B00000000);
+	RGBLCD_STAT_REGISTER();
+	// invert the bits connected to the keys so that key pressed is high now
+	Transport::write(_address, IPOLA, keyPins);
+	RGBLCD_STAT_REGISTER();
+	if (!_keyPolled && _keyPin != noInterruptPin) {
+		// interrupt on every change of a key compared to its previous value
+		Transport::write(_address, INTCONA, B00000000);
+		RGBLCD_STAT_REGISTER();
+		Transport::write(_address, DEFVALA, B00000000);
+		RGBLCD_STAT_REGISTER();
+		Transport::write(_address, GPINTENA, keyPins);
+		RGBLCD_STAT_REGISTER();
+		// INTA is active low
+		pinMode(_keyPin, INPUT_PULLUP);
+	}
+}
+
+/*
+ * Helper function to initialize the lcd and clear it, the display control
+ * and entry mode are set from their shadows
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_setupLcd() {
+	/* Initialize the lcd display
+	 * For an explanation what is going on see the Wikipedia
+	 * Hitachi HD44780 LCD controller entry
+	 */
+
+	// the busy flag can't be checked before the lcd is initialized
+	_waitDeadline();
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+	_lcdWrite4(B0011, true);
+	Transport::sync();
+	if (_waitMode == wmDelay) {
+		delay(5);
+		RGBLCD_STAT_DELAY(5000);
+	} else {
+		delayMicroseconds(4100);
+		RGBLCD_STAT_DELAY(4100);
+	}
+	_lcdWrite4(B0011, true);
+	_padOwed = _padding(initMicros);
+	_lcdWrite4(B0011, true);
+	_padOwed = _padBytes;
+	// should be in 8 bit mode now so set to 4 bit mode
+	_lcdWrite4(B0010, true);
+	_padOwed = _padBytes;
+	// set 2 lines and 5x8 dots
+	_lcdWrite8(functionSet | lineMode2Flag, true);
+	// set on, no cursor and no blinking
+	_lcdWrite8(_shadowDisplayControl, true);
+	// left to right, no shift
+	_lcdWrite8(_shadowEntryModeSet, true);
+	Transport::stop();
+
+	// Clear entire display, this also returns a shifted display
+	// to its original position
+	_lcdTransmit(clearDisplay, true);
+	_setBusy(2);
+	_addressCounter = 0;
+}
+
+/*
+ * Clear the display and set the cursor in the upper left corner,
+ * set left to right (undocumented :( )
+ * takes about two milliseconds, see setWaitMode.
+ * With the frame buffer enabled the frame is blanked and the entry mode
+ * set to left to right without shift as the lcd would, but a display
+ * shift is kept: the lcd isn't cleared so it can't be undone.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::clear() {
+	RGBLCD_STAT_ENTRY(epClear);
+	if (_frame) {
+		memset(_frame, ' ', frameCells);
+		_frameCol = 0;
+		_frameRow = 0;
+		if (_shadowEntryModeSet != (int8_t) (entryModeSet | left2RightFlag)) {
+			_shadowEntryModeSet = entryModeSet | left2RightFlag;
+			_lcdTransmit(_shadowEntryModeSet, true);
+		}
+		return;
+	}
+	_lcdTransmit(clearDisplay, true);
+	// Synchronize left2RightFlag;
+	_shadowEntryModeSet = entryModeSet | left2RightFlag; // left to right, no shift
+	_addressCounter = 0;
+	_setBusy(2);
+}
+
+/*
+ * Set the cursor in the upper left corner,
+ * takes about two milliseconds, see setWaitMode.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::home() {
+	RGBLCD_STAT_ENTRY(epHome);
+	if (_frame) {
+		_frameCol = 0;
+		_frameRow = 0;
+		return;
+	}
+	_lcdTransmit(returnHome, true);
+	_addressCounter = 0;
+	_setBusy(2);
+}
+
+/*
+ * Sets the position of the cursor at which subsequent characters
+ * will appear.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::setCursor(uint8_t col, uint8_t row) {
+	RGBLCD_STAT_ENTRY(epCursor);
+	if (_frame) {
+		_frameCol = col;
+		_frameRow = row;
+		return;
+	}
+	_addressCounter = col + _rowAddress(row);
+	_lcdTransmit(setDdRamAdr | _addressCounter, true);
+}
+
+/*
+ * Sets the color of the backlight of the display.
+ * Only the ports of which a led changes are written. With a queue the
+ * change is queued after the text, otherwise a change of port B alone is
+ * sent as one byte in an open batch.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::setColor(colors color) {
+	RGBLCD_STAT_ENTRY(epColor);
+	uint8_t _color;
+	int8_t shadowA = _shadowGPIOA;
+	int8_t shadowB = _shadowGPIOB;
+	_invertedBacklight ? _color =~ color : _color = color;
+	_writeLed(Wiring::red, !(_color & clRed));
+	_writeLed(Wiring::green, !(_color & clGreen));
+	_writeLed(Wiring::blue, !(_color & clBlue));
+	bool changedA = _shadowGPIOA != shadowA;
+	bool changedB = _shadowGPIOB != shadowB;
+	if (!changedA && !changedB)
+		return;
+	if (_queue) {
+		// in order with the text already queued, the lcd pins keep their state
+		_queueReserve(changedA ? 3 : 1);
+		if (changedA) {
+			_enqueue(queuePortAMarker);
+			_enqueue(_shadowGPIOA);
+		}
+		if (changedB)
+			_enqueue(_shadowGPIOB);
+		return;
+	}
+	if (!changedA && _batchDepth) {
+		// one byte in the open transmission to GPIOB
+		Transport::send(_shadowGPIOB);
+		RGBLCD_STAT_WRITE(1);
+		return;
+	}
+	_suspendBatch();
+	if (changedA) {
+		Transport::write(_address, GPIOA, _shadowGPIOA);
+		RGBLCD_STAT_REGISTER();
+	}
+	if (changedB) {
+		Transport::write(_address, GPIOB, _shadowGPIOB);
+		RGBLCD_STAT_REGISTER();
+	}
+	_resumeBatch();
+}
+
+/*
+ * turn the display pixels on
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::display() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl |= displayOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * turn the display pixels off
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::noDisplay() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl &= ~displayOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * Enables the blinking of the selected character
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::blink() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl |= blinkOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * Disables the blinking of the selected character
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::noBlink() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl &= ~blinkOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * Enables the cursor
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::cursor() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl |= cursorOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * Disables the cursor
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::noCursor() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowDisplayControl &= ~cursorOnFlag;
+	_lcdTransmit(_shadowDisplayControl, true);
+}
+
+/*
+ * Scrolls the display to the right
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::scrollDisplayRight() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_lcdTransmit(curOrDispShift | displayShiftFlag | shiftRightFlag, true);
+}
+
+/*
+ * Scrolls the display to the left
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::scrollDisplayLeft() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_lcdTransmit(curOrDispShift | displayShiftFlag, true);
+}
+
+/*
+ * All subsequent characters written to the display will go
+ * from left to right.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::leftToRight() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowEntryModeSet |= left2RightFlag;
+	_lcdTransmit(_shadowEntryModeSet, true);
+}
+
+/*
+ * All subsequent characters written to the display will go
+ * from right to left.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::rightToLeft() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowEntryModeSet &= ~left2RightFlag;
+	_lcdTransmit(_shadowEntryModeSet, true);
+}
+
+/*
+ * Moves the cursor to the right
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::moveCursorRight() {
+	RGBLCD_STAT_ENTRY(epCursor);
+	if (_frame) {
+		_frameCol++;
+		return;
+	}
+	_lcdTransmit(curOrDispShift | shiftRightFlag, true);
+	_stepAddress(true);
+}
+
+/*
+ * Moves the cursor to the left
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::moveCursorLeft() {
+	RGBLCD_STAT_ENTRY(epCursor);
+	if (_frame) {
+		_frameCol--;
+		return;
+	}
+	_lcdTransmit(curOrDispShift, true);
+	_stepAddress(false);
+}
+
+/*
+ * Turns the automatic scrolling of the display on.
+ * New characters will appear at the same location and
+ * the content of the display will scroll right or left
+ * depending of the write direction.
+ */
+
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::autoscroll() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowEntryModeSet |= autoShiftFlag;
+	_lcdTransmit(_shadowEntryModeSet, true);
+}
+
+/*
+ * Turns off automatic scrolling of the display.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::noAutoscroll() {
+	RGBLCD_STAT_ENTRY(epControl);
+	_shadowEntryModeSet &= ~autoShiftFlag;
+	_lcdTransmit(_shadowEntryModeSet, true);
+}
+
+/*
+ * Continues writing on the next row when the end of a row is reached,
+ * within the same transmission. Only when writing left to right without
+ * autoscroll, the last row continues on the first.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::lineWrap() {
+	_lineWrap = true;
+}
+
+/*
+ * Characters written past the end of a row go to the invisible part of
+ * DDRAM, or for four row displays to the row after the next one, the default
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::noLineWrap() {
+	_lineWrap = false;
+}
+
+/*
+ * Loads a special character
+ * The cursor position is restored after this call
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::createChar(uint8_t location, const uint8_t *charmap) {
+	RGBLCD_STAT_ENTRY(epCreateChar);
+	location &= 0x7;   // we only have 8 memory locations 0-7
+	_beginTransmission();
+	_lcdWrite8(setCgRamAdr | location << 3, true);
+	for (uint8_t n = 0; n < 8; n++)
+		_lcdWrite8(charmap[n], false);
+	_lcdWrite8(setDdRamAdr | _addressCounter, true);   // restore the cursor
+	_endTransmission();
+}
+
+/*
+ * Loads only the rows first to first + count - 1 of a special character,
+ * e.g. when a bar graph grows by a pixel.
+ * The cursor position is restored after this call
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::updateChar(uint8_t location,
+		uint8_t first, const uint8_t *rows, uint8_t count) {
+	RGBLCD_STAT_ENTRY(epCreateChar);
+	location &= 0x7;   // we only have 8 memory locations 0-7
+	first &= 0x7;
+	if (count > 8 - first)
+		count = 8 - first;
+	_beginTransmission();
+	_lcdWrite8(setCgRamAdr | location << 3 | first, true);
+	for (uint8_t n = 0; n < count; n++)
+		_lcdWrite8(rows[n], false);
+	_lcdWrite8(setDdRamAdr | _addressCounter, true);   // restore the cursor
+	_endTransmission();
+}
+
+#ifdef __AVR__
+/*
+ * Loads a special character from program memory
+ * The cursor position is restored after this call
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::createCharP(uint8_t location, const uint8_t *charmap) {
+	RGBLCD_STAT_ENTRY(epCreateChar);
+	location &= 0x7;   // we only have 8 memory locations 0-7
+	_beginTransmission();
+	_lcdWrite8(setCgRamAdr | location << 3, true);
+	for (uint8_t n = 0; n < 8; n++)
+		_lcdWrite8(pgm_read_byte(&charmap[n]), false);
+	_lcdWrite8(setDdRamAdr | _addressCounter, true);   // restore the cursor
+	_endTransmission();
+}
+
+/*
+ * Writes a string in program memory to the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::printP(const char str[]) {
+	RGBLCD_STAT_ENTRY(epWrite);
+	size_t n = 0;
+	char c = pgm_read_byte(&str[n]);
+	if (_frame) {
+		while (c) {
+			_frameWrite(c);
+			c = pgm_read_byte(&str[++n]);
+		}
+		return n;
+	}
+	_beginTransmission();
+	while (c && !_queueDrops()) {
+		_lcdWrite8(c, false);
+		_advanceWrite();
+		c = pgm_read_byte(&str[++n]);
+	};
+	_endTransmission();
+	return n;
+}
+
+/*
+ * does the same as write(const uint8_t* buffer, size_t size)
+ * but from program memory instead
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::writeP(const uint8_t* buffer, size_t size) {
+	RGBLCD_STAT_ENTRY(epWrite);
+	size_t n = 0;
+	if (_frame) {
+		while (n < size)
+			_frameWrite(pgm_read_byte(&buffer[n++]));
+		return n;
+	}
+	_beginTransmission();
+	while (n < size && !_queueDrops()) {
+		_lcdWrite8(pgm_read_byte(&buffer[n++]), false);
+		_advanceWrite();
+	};
+	_endTransmission();
+	return n;
+}
+#endif // __AVR__
+
+/*
+ * Writes a character to the screen
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::write(uint8_t c) {
+	RGBLCD_STAT_ENTRY(epWrite);
+	if (_frame) {
+		_frameWrite(c);
+		return 1;
+	}
+	if (_queueDrops())
+		return 0;
+	_beginTransmission();
+	_lcdWrite8(c, false);
+	_advanceWrite();
+	_endTransmission();
+	return 1;
+}
+
+/*
+ * Reads a character from the screen
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::read() {
+	RGBLCD_STAT_ENTRY(epRead);
+	uint8_t value;
+	_flushQueue();
+	if (_busy)
+		_waitReady();
+	_suspendBatch();
+	_prepareRead(false);
+	value =  _lcdRead8();
+	_cleanupRead();
+	_resumeBatch();
+	_advanceCursor();
+	return value;
+}
+
+/*
+ * Reads multiple characters from the screen into a buffer
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::read(uint8_t* buffer, size_t size) {
+	RGBLCD_STAT_ENTRY(epRead);
+	size_t n = 0;
+	_flushQueue();
+	if (_busy)
+		_waitReady();
+	_suspendBatch();
+	_prepareRead(false);
+	while (n < size) {
+		buffer[n++] = _lcdRead8();
+		_advanceCursor();
+	}
+	_cleanupRead();
+	_resumeBatch();
+	return n;
+}
+
+/*
+ * Reads the visible characters of the display row by row into a buffer
+ * of columns * rows bytes, e.g. to verify the screen or take a screenshot.
+ * The cursor and write direction are restored afterwards.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::readScreen(uint8_t* buffer) {
+	RGBLCD_STAT_ENTRY(epRead);
+	uint8_t cursor = _addressCounter;
+	uint8_t entryModeSet = _shadowEntryModeSet;
+	// the rows are read left to right
+	if (!(entryModeSet & left2RightFlag)) {
+		_shadowEntryModeSet |= left2RightFlag;
+		_lcdTransmit(_shadowEntryModeSet, true);
+	}
+	for (uint8_t row = 0; row < rows; row++) {
+		_addressCounter = _rowAddress(row);
+		_lcdTransmit(setDdRamAdr | _addressCounter, true);
+		read(buffer + row * columns, columns);
+	}
+	if (entryModeSet != (uint8_t) _shadowEntryModeSet) {
+		_shadowEntryModeSet = entryModeSet;
+		_lcdTransmit(_shadowEntryModeSet, true);
+	}
+	_addressCounter = cursor;
+	_lcdTransmit(setDdRamAdr | _addressCounter, true);
+	return rows * columns;
+}
+
+/*
+ * Returns the cursor position as DDRAM address (col + 0x40 for the second
+ * row, four row displays continue the first two rows in the third and
+ * fourth), the address counter is tracked so the bus is not used
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::getCursor() {
+	if (_frame)
+		return _frameCol + _rowAddress(_frameRow);
+	return _addressCounter;
+}
+
+/*
+ * Overrides the standard implementation
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+size_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::write(const uint8_t* buffer, size_t size) {
+	RGBLCD_STAT_ENTRY(epWrite);
+	size_t n = 0;
+	if (_frame) {
+		while (n < size)
+			_frameWrite(buffer[n++]);
+		return n;
+	}
+	_beginTransmission();
+	while (n < size && !_queueDrops()) {
+		_lcdWrite8(buffer[n++], false);
+		_advanceWrite();
+	}
+	_endTransmission();
+	return n;
+}
+
+/*
+ * Selects how the execution time of clear, home and the power up in begin
+ * is handled:
+ * wmDelay    blocks with delay, the default.
+ * wmDeadline returns immediately, the next lcd access waits only for the
+ *            remaining time. The keys and backlight can be used meanwhile.
+ * wmBusyFlag as wmDeadline but the next lcd access polls the busy flag
+ *            instead, the deadline is used as a timeout.
+ * To be called before begin.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::setWaitMode(waitModes mode) {
+	_waitMode = mode;
+}
+
+/*
+ * Tells the clock of the bus in Hz. Up to 400 kHz sending an instruction
+ * takes longer than the lcd needs to execute the previous one. Above that
+ * as many dummy writes of GPIOB are added as are needed to give the lcd
+ * its 41 us, e.g. three bytes per character at 1 MHz. They are only sent
+ * when another instruction follows in the same transmission. To be called
+ * before begin, without it nothing is padded.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::setBusClock(uint32_t hz) {
+	_busClock = hz;
+	_padBytes = _padding(instructionMicros);
+}
+
+/*
+ * Returns true if the lcd finished the last clear or home
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+bool RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::isReady() {
+	if (_busy && (int32_t) (micros() - _readyAt) >= 0)
+		_busy = false;
+	return !_busy;
+}
+
+/*
+ * Queues all subsequent lcd traffic in a ring buffer instead of sending it.
+ * Characters are translated to pin values when they are queued, so printing
+ * only costs a few microseconds. The queue is sent by calling poll from the
+ * main loop. When the buffer is full the policy decides:
+ * opBlock    sends the oldest entries until the new one fits.
+ * opDrop     discards characters that don't fit, instructions block.
+ * opCoalesce sends the complete backlog in one transmission.
+ * setColor is queued as well, read and disableQueue send the backlog first,
+ * so they stay in order with the text. readKeys doesn't interfere as the queue is only sent
+ * from poll. Every character takes four bytes of the buffer, plus the
+ * padding set by setBusClock. A buffer that can't hold one character is
+ * refused and false returned, the writes stay direct. To be called after
+ * begin and outside a batch.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+bool RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::enableQueue(uint8_t* buffer, uint8_t size,
+		overflowPolicies policy) {
+	if (!buffer || size < 4 + _padBytes)
+		return false;
+	_queue = buffer;
+	_queueSize = size;
+	_queueHead = 0;
+	_queueTail = 0;
+	_queueCount = 0;
+	_overflowPolicy = policy;
+	return true;
+}
+
+/*
+ * Sends the backlog and returns to direct writing
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::disableQueue() {
+	_flushQueue();
+	_queue = nullptr;
+}
+
+/*
+ * Sends at most maxBytes of the queue in one transmission, to be placed
+ * in the main loop. Returns immediately while the lcd executes a clear
+ * or home.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::poll(uint8_t maxBytes) {
+	RGBLCD_STAT_ENTRY(epPoll);
+	_drainQueue(maxBytes, false);
+}
+
+/*
+ * Sends as much of the queue as fits in budget microseconds, to be placed
+ * in the main loop instead of poll. The transmission to GPIOB is ended
+ * after any byte and resumed by the next call, so a long update never
+ * holds the bus for much longer than the budget; the overrun is at most
+ * the time of one byte and the stop condition. When the loop has nothing
+ * else to do a large budget sends the queue at full speed. Returns
+ * immediately while the lcd executes a clear or home.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::service(uint16_t budget) {
+	RGBLCD_STAT_ENTRY(epPoll);
+	if (!_queue || !budget)
+		return;
+	uint32_t start = micros();
+	while (_queueCount && isReady() && micros() - start < budget)
+		_drainQueue(0xFF, false, start, budget);
+}
+
+/*
+ * Returns true when everything queued has been sent
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+bool RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::flushed() {
+	return !_queue || !_queueCount;
+}
+
+/*
+ * Opens a batch, all lcd instructions and characters up to the matching
+ * endBatch are streamed in a single transmission so the start, address
+ * and register overhead is paid only once. Batches can be nested.
+ * Calls that need another register (setColor, read, readKeys) close
+ * and reopen the transmission.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::beginBatch() {
+	RGBLCD_STAT_ENTRY(epBatch);
+	if (_batchDepth++ || _queue)
+		return;
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+}
+
+/*
+ * Closes a batch, the transmission ends with the outermost endBatch.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::endBatch() {
+	RGBLCD_STAT_ENTRY(epBatch);
+	if (!_batchDepth)
+		return;
+	if (!--_batchDepth && !_queue)
+		Transport::stop();
+}
+
+/*
+ * Redirects all subsequent writes, cursor movements and clears to a frame
+ * buffer in RAM. Nothing is sent to the display until flush is called.
+ * The buffer must be frameBufferSize bytes long and stay valid until
+ * disableFrameBuffer is called.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::enableFrameBuffer(uint8_t* buffer) {
+	_frame = buffer;
+	memset(_frame, ' ', frameCells);
+	_frameCol = 0;
+	_frameRow = 0;
+	invalidate();
+}
+
+/*
+ * Writes the pending changes to the display and returns to
+ * direct writing.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::disableFrameBuffer() {
+	if (!_frame)
+		return;
+	flush();
+	_frame = nullptr;
+}
+
+/*
+ * Forces the next flush to rewrite every cell, e.g. after the display
+ * content was changed behind the back of the frame buffer.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::invalidate() {
+	_frameValid = false;
+	_scrubRewrite = false;
+}
+
+/*
+ * Sends the cells of the frame that differ from what the display shows
+ * in a single transmission. Consecutive changed cells are streamed,
+ * a jump costs as much as one character so a single unchanged cell
+ * between two changes is rewritten instead of jumped over.
+ * The cursor of the display is left at the cursor of the frame.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::flush() {
+	RGBLCD_STAT_ENTRY(epFlush);
+	if (!_frame)
+		return;
+	uint8_t* shown = _frame + frameCells;
+	// the diff is written left to right without shifting
+	uint8_t flushModeSet = (_shadowEntryModeSet | left2RightFlag) & ~autoShiftFlag;
+	uint8_t cursor = _frameCol + _rowAddress(_frameRow);
+	bool open = false;
+	// in DDRAM order, the third row continues the first
+	for (uint8_t line = 0; line < rows; line++) {
+		uint8_t row = line < 2 ? line * (rows / 2) : (line - 2) * (rows / 2) + 1;
+		uint8_t* cell = _frame + row * columns;
+		for (uint8_t col = 0; col < columns; col++) {
+			uint8_t i = row * columns + col;
+			if (_frameValid && cell[col] == shown[i])
+				continue;
+			uint8_t address = col + _rowAddress(row);
+			if (!open) {
+				_flushOpen(flushModeSet);
+				open = true;
+			}
+			if (_addressCounter != address) {
+				if (col && _addressCounter == address - 1)
+					_lcdWrite8(cell[col - 1], false);
+				else
+					_lcdWrite8(setDdRamAdr | address, true);
+			}
+			_lcdWrite8(shown[i] = cell[col], false);
+			_addressCounter = address;
+			_stepAddress(true);
+		}
+	}
+	_frameValid = true;
+	// leave the cursor of the display at the cursor of the frame
+	if (_frameCol < columns && _frameRow < rows && _addressCounter != cursor) {
+		if (!open) {
+			_flushOpen(flushModeSet);
+			open = true;
+		}
+		_lcdWrite8(setDdRamAdr | cursor, true);
+		_addressCounter = cursor;
+	}
+	if (!open)
+		return;
+	if (flushModeSet != (uint8_t) _shadowEntryModeSet)
+		_lcdWrite8(_shadowEntryModeSet, true);
+	_endTransmission();
+}
+
+/*
+ * Reads back a few cells of the display, at most 8 and not past the end
+ * of a row, and compares them with what the frame buffer has shown. Cells
+ * that differ are written again, each call continues where the previous
+ * one stopped. Does nothing without a valid frame buffer or while the lcd
+ * is busy. Returns the number of cells written again. To be called
+ * outside a batch.
+ *
+ * When more than half of four or more cells differ the lcd is considered
+ * lost. If reinitialize is true the shield is then set up again and the
+ * lcd cleared, which blocks for about 5 ms also in wmDelay mode, and
+ * screenSize is returned. The display control and entry mode are
+ * restored, a display shift is undone and the special characters are
+ * lost, they must be loaded again by the caller. The following calls
+ * write the frame back a few cells at a time without reading it.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::scrub(uint8_t cells,
+		bool reinitialize) {
+	RGBLCD_STAT_ENTRY(epRead);
+	if (!_frame || !_frameValid || !isReady())
+		return 0;
+	uint8_t* shown = _frame + frameCells;
+	uint8_t row = _scrubCell / columns;
+	uint8_t col = _scrubCell % columns;
+	if (cells > maxScrubCells)
+		cells = maxScrubCells;
+	if (cells > columns - col)
+		cells = columns - col;
+	uint8_t buffer[maxScrubCells];
+	// the cursor of the lcd is lost after an initialization, it returns
+	// to where the frame has it as after a flush
+	uint8_t cursor = _scrubRewrite ? getCursor() : _addressCounter;
+	uint8_t entryModeSet = _shadowEntryModeSet;
+	// read and write left to right without shifting
+	_shadowEntryModeSet = (entryModeSet | left2RightFlag) & ~autoShiftFlag;
+	_beginTransmission();
+	// the entry mode of the lcd is not known after an initialization
+	if (_scrubRewrite || entryModeSet != (uint8_t) _shadowEntryModeSet)
+		_lcdWrite8(_shadowEntryModeSet, true);
+	_addressCounter = col + _rowAddress(row);
+	_lcdWrite8(setDdRamAdr | _addressCounter, true);
+	_endTransmission();
+	if (_scrubRewrite)
+		// the cleared lcd holds blanks
+		memset(buffer, ' ', cells);
+	else
+		read(buffer, cells);
+	uint8_t* expected = shown + _scrubCell;
+	uint8_t wrong = 0;
+	for (uint8_t n = 0; n < cells; n++)
+		if (buffer[n] != expected[n])
+			wrong++;
+	if (reinitialize && !_scrubRewrite && cells >= 4 && wrong * 2 > cells) {
+		_shadowEntryModeSet = entryModeSet;
+		_reinitialize();
+		return screenSize;
+	}
+	_scrubCell += cells;
+	if (_scrubCell == frameCells) {
+		_scrubCell = 0;
+		_scrubRewrite = false;
+	}
+	_beginTransmission();
+	for (uint8_t n = 0; n < cells; n++) {
+		if (buffer[n] == expected[n])
+			continue;
+		uint8_t address = col + n + _rowAddress(row);
+		if (_addressCounter != address)
+			_lcdWrite8(setDdRamAdr | address, true);
+		_lcdWrite8(expected[n], false);
+		_addressCounter = address;
+		_stepAddress(true);
+	}
+	if (entryModeSet != (uint8_t) _shadowEntryModeSet) {
+		_shadowEntryModeSet = entryModeSet;
+		_lcdWrite8(_shadowEntryModeSet, true);
+	}
+	if (_addressCounter != cursor) {
+		_lcdWrite8(setDdRamAdr | cursor, true);
+		_addressCounter = cursor;
+	}
+	_endTransmission();
+	return wrong;
+}
+
+/*
+ * Helper function for scrub to set up a lost shield again without the
+ * power up delay of begin. The clear is not waited for, so also in
+ * wmDelay mode only the 4.1 ms of the initialization block. The frame
+ * is written back by the next calls of scrub.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_reinitialize() {
+	// sent directly, the queue is empty after the read of scrub
+	uint8_t* queue = _queue;
+	waitModes waitMode = _waitMode;
+	_queue = nullptr;
+	_waitMode = wmDeadline;
+	_setupPorts();
+	_setupLcd();
+	_waitMode = waitMode;
+	_queue = queue;
+	_scrubCell = 0;
+	_scrubRewrite = true;
+}
+
+/*
+ * Read the keys only when the INT line of the MCP23017 signals a change or
+ * the fallback interval in milliseconds expired, otherwise readKeys works
+ * with the last state read. The INTA pin of the MCP23017 must be connected
+ * to the given pin, use noInterruptPin to only read every fallback interval.
+ * To be called before begin.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::setKeyInterrupt(uint8_t pin,
+		uint16_t fallbackInterval) {
+	_keyPin = pin;
+	_keyInterval = fallbackInterval;
+	_keyPolled = false;
+}
+
+/*
+ * Read the keys. To be placed in the main loop.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::readKeys() {
+	RGBLCD_STAT_ENTRY(epReadKeys);
+	uint8_t keyState = _keyState;
+	// one timestamp for all the keys
+	uint32_t now = millis();
+	if (_keyPolled || (_keyPin != noInterruptPin && !digitalRead(_keyPin))
+			|| now - _keyReadTime >= _keyInterval) {
+		_suspendBatch();
+		// reading GPIOA also clears the interrupt
+		keyState = Transport::read(_address, GPIOA);
+		RGBLCD_STAT_REGISTER_READ(1);
+		_resumeBatch();
+		_keyState = keyState;
+		_keyReadTime = now;
+	}
+	// the pressed keys as a KeyEvent mask, independent of the wiring
+	uint8_t keys = 0;
+	if (keyState & (1 << Wiring::left))
+		keys |= KeyEvent::kmLeft;
+	if (keyState & (1 << Wiring::up))
+		keys |= KeyEvent::kmUp;
+	if (keyState & (1 << Wiring::down))
+		keys |= KeyEvent::kmDown;
+	if (keyState & (1 << Wiring::right))
+		keys |= KeyEvent::kmRight;
+	if (keyState & (1 << Wiring::select))
+		keys |= KeyEvent::kmSelect;
+	_readKey(keyLeft, KeyEvent::kmLeft, keys & KeyEvent::kmLeft, now);
+	_readKey(keyUp, KeyEvent::kmUp, keys & KeyEvent::kmUp, now);
+	_readKey(keyDown, KeyEvent::kmDown, keys & KeyEvent::kmDown, now);
+	_readKey(keyRight, KeyEvent::kmRight, keys & KeyEvent::kmRight, now);
+	_readKey(keySelect, KeyEvent::kmSelect, keys & KeyEvent::kmSelect, now);
+	if (_keyEvents)
+		_detectChord(keys, now);
+}
+
+#ifdef RGBLCD_STATS
+/*
+ * Returns the counters, assign them to a LcdStats to take a snapshot
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+const LcdStats& RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::stats() const {
+	return _stats;
+}
+
+/*
+ * Sets all counters to zero
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::resetStats() {
+	_stats.reset();
+}
+#endif // RGBLCD_STATS
+
+/*
+ * Stores the key events with a timestamp in a ring buffer instead of calling
+ * the callbacks from readKeys, so a slow application doesn't miss presses.
+ * Additionally chords of any number of keys are reported. The application
+ * takes the events with readKeyEvent and can pass them to dispatchKeyEvent
+ * to call the callbacks. When the buffer is full new events are dropped.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::enableKeyEvents(KeyEvent* buffer,
+		uint8_t size) {
+	_keyEvents = buffer;
+	_keyEventSize = size;
+	_keyEventHead = 0;
+	_keyEventCount = 0;
+	_chordKeys = 0;
+	_chordReported = false;
+	_chordRaw = 0;
+	_chordStamp = 0;
+}
+
+/*
+ * Returns to calling the callbacks from readKeys, pending events are lost
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::disableKeyEvents() {
+	_keyEvents = nullptr;
+}
+
+/*
+ * Takes the oldest event from the queue, returns false if there is none
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+bool RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::readKeyEvent(KeyEvent& event) {
+	if (!_keyEvents || !_keyEventCount)
+		return false;
+	event = _keyEvents[_keyEventHead];
+	if (++_keyEventHead == _keyEventSize)
+		_keyEventHead = 0;
+	_keyEventCount--;
+	return true;
+}
+
+/*
+ * Calls the callbacks of the key for an event, chords have no callback
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::dispatchKeyEvent(const KeyEvent& event) {
+	SimpleKeyHandler* key = _keyOf(event.keys);
+	if (!key)
+		return;
+	if (event.type == KeyEvent::evTwoPress)
+		key->dispatch(event.type, 0, _keyOf(event.count));
+	else
+		key->dispatch(event.type, event.count, nullptr);
+}
+
+/*
+ * Calls the callbacks for all queued events, to be placed in the main loop
+ * when the callbacks are used together with the event queue
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::dispatchKeyEvents() {
+	KeyEvent event;
+	while (readKeyEvent(event))
+		dispatchKeyEvent(event);
+}
+
+/*
+ * Clear all the callback pointers
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::clearKeys() {
+	keyLeft.clear();
+	keyUp.clear();
+	keyDown.clear();
+	keyRight.clear();
+	keySelect.clear();
+}
+
+// Private declarations--------------------------------------------
+
+/*
+ * Helper function to read a key and queue or dispatch its events
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_readKey(SimpleKeyHandler& key,
+		uint8_t mask, bool keyState, uint32_t now) {
+	uint8_t events = key.read<KeyTiming>(keyState, now);
+	if (!events)
+		return;
+	uint16_t count = SimpleKeyHandler::_count - 1;
+	if (!_keyEvents) {
+		key.dispatch(events, count, SimpleKeyHandler::_otherKey);
+		return;
+	}
+	for (uint8_t type = KeyEvent::evPress; type <= KeyEvent::evRelease; type <<= 1) {
+		if (!(events & type))
+			continue;
+		if (type == KeyEvent::evTwoPress)
+			_pushKeyEvent(mask, type, _maskOf(SimpleKeyHandler::_otherKey), now);
+		else
+			_pushKeyEvent(mask, type, type == KeyEvent::evRepPress ? count : 0, now);
+	}
+}
+
+/*
+ * Helper function to add an event to the queue, dropped when full
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_pushKeyEvent(uint8_t keys,
+		uint8_t type, uint16_t count, uint32_t time) {
+	if (_keyEventCount == _keyEventSize)
+		return;
+	uint8_t i = _keyEventHead + _keyEventCount;
+	if (i >= _keyEventSize)
+		i -= _keyEventSize;
+	_keyEvents[i].keys = keys;
+	_keyEvents[i].type = type;
+	_keyEvents[i].count = count;
+	_keyEvents[i].time = time;
+	_keyEventCount++;
+}
+
+/*
+ * Helper function to detect chords on the mask of all keys read from GPIOA.
+ * The mask is debounced as a whole, it counts once it didn't change for the
+ * debounce time. The keys pressed together are collected until the first
+ * one is released, if there are two or more this is reported once as a chord.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_detectChord(uint8_t pressed,
+		uint32_t now) {
+	if (pressed != _chordRaw) {
+		// start the debounce time
+		_chordRaw = pressed;
+		_chordStamp = now;
+		return;
+	}
+	if ((uint16_t) ((uint16_t) now - _chordStamp) < KeyTiming::debounce)
+		return;
+	if (pressed & ~_chordKeys) {
+		// a key joined
+		_chordKeys |= pressed;
+		return;
+	}
+	if (pressed == _chordKeys)
+		return;
+	// a key was released, more than one bit set is a chord
+	if (!_chordReported && (_chordKeys & (_chordKeys - 1)))
+		_pushKeyEvent(_chordKeys, KeyEvent::evChord, 0, now);
+	_chordReported = true;
+	if (!pressed) {
+		_chordKeys = 0;
+		_chordReported = false;
+	}
+}
+
+/*
+ * Helper function to find the key for a mask
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+SimpleKeyHandler* RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_keyOf(uint8_t mask) {
+	switch (mask) {
+	case KeyEvent::kmLeft:
+		return &keyLeft;
+	case KeyEvent::kmUp:
+		return &keyUp;
+	case KeyEvent::kmDown:
+		return &keyDown;
+	case KeyEvent::kmRight:
+		return &keyRight;
+	case KeyEvent::kmSelect:
+		return &keySelect;
+	default:
+		return nullptr;
+	}
+}
+
+/*
+ * Helper function to find the mask of a key
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_maskOf(const SimpleKeyHandler* key) {
+	if (key == &keyLeft)
+		return KeyEvent::kmLeft;
+	if (key == &keyUp)
+		return KeyEvent::kmUp;
+	if (key == &keyDown)
+		return KeyEvent::kmDown;
+	if (key == &keyRight)
+		return KeyEvent::kmRight;
+	if (key == &keySelect)
+		return KeyEvent::kmSelect;
+	return 0;
+}
+
+/*
+ * Helper function to set a led in the shadow registers,
+ * 0 to 7 are on port A and 8 to 15 on port B
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_writeLed(uint8_t led, bool value) {
+	if (led < 8)
+		bitWrite(_shadowGPIOA, led, value);
+	else
+		bitWrite(_shadowGPIOB, led - 8, value);
+}
+
+/*
+ * Helper function to follow the address counter of the lcd after
+ * a character is written or read
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_advanceCursor() {
+	_stepAddress(_shadowEntryModeSet & left2RightFlag);
+}
+
+/*
+ * Helper function to follow the address counter after a character
+ * is written and wrap to the next row if enabled
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_advanceWrite() {
+	_advanceCursor();
+	if (_lineWrap)
+		_wrapLine();
+}
+
+/*
+ * Helper function to move the address counter to the next row when it
+ * passed the end of a row, sent in the open transmission
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_wrapLine() {
+	if ((_shadowEntryModeSet & (left2RightFlag | autoShiftFlag)) != left2RightFlag)
+		return;
+	for (uint8_t row = 0; row < rows; row++) {
+		uint8_t end = _rowAddress(row) + columns;
+		// at the end of a DDRAM line the counter already wrapped
+		if (end == columnsPerLine)
+			end = rowOffset;
+		else if (end == rowOffset + columnsPerLine)
+			end = 0;
+		if (_addressCounter != end)
+			continue;
+		uint8_t next = _rowAddress(row + 1 == rows ? 0 : row + 1);
+		if (_addressCounter != next) {
+			_addressCounter = next;
+			_lcdWrite8(setDdRamAdr | _addressCounter, true);
+		}
+		return;
+	}
+}
+
+/*
+ * Helper function to increment or decrement the address counter.
+ * In two line mode the counter runs from 0x27 to 0x40 and
+ * from 0x67 back to 0x00.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_stepAddress(bool increment) {
+	if (increment) {
+		if (++_addressCounter == columnsPerLine)
+			_addressCounter = rowOffset;
+		else if (_addressCounter == rowOffset + columnsPerLine)
+			_addressCounter = 0;
+	} else {
+		if (_addressCounter == 0)
+			_addressCounter = rowOffset + columnsPerLine - 1;
+		else if (_addressCounter == rowOffset)
+			_addressCounter = columnsPerLine - 1;
+		else
+			_addressCounter--;
+	}
+}
+
+/*
+ * Helper function to open the transmission of a flush
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_flushOpen(uint8_t flushModeSet) {
+	_beginTransmission();
+	if (flushModeSet != (uint8_t) _shadowEntryModeSet)
+		_lcdWrite8(flushModeSet, true);
+}
+
+/*
+ * Helper function to write a character into the frame buffer,
+ * characters outside the display are dropped
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_frameWrite(uint8_t c) {
+	if (_frameCol < columns && _frameRow < rows) {
+		_frame[_frameRow * columns + _frameCol] = c;
+		if (_shadowEntryModeSet & left2RightFlag) {
+			if (++_frameCol == columns && _lineWrap) {
+				_frameCol = 0;
+				if (++_frameRow == rows)
+					_frameRow = 0;
+			}
+		} else
+			_frameCol--;
+	}
+}
+
+/*
+ * Helper function to write a nibble to the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_lcdWrite4(uint8_t value, bool lcdInstruction) {
+	_pad();
+	_nibbleToShadow(value, lcdInstruction);
+	// send the data
+	Transport::send(_shadowGPIOB);
+	// Toggle the enable bit
+	_shadowGPIOB ^= ePin;
+	// and send again
+	Transport::send(_shadowGPIOB);
+	RGBLCD_STAT_WRITE(2);
+}
+
+/*
+ * Helper function to put a nibble on the lcd pins of shadowB
+ * with the enable bit set
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_nibbleToShadow(uint8_t value, bool lcdInstruction) {
+	// clear the lcd bits of shadowB
+	_shadowGPIOB &= ~lcdPins;
+	// Translate the least nibble only
+#ifdef __AVR__
+	_shadowGPIOB |= pgm_read_byte(&_nibbleToPin[value & B00001111]);
+#else
+	_shadowGPIOB |= _nibbleToPin[value & B00001111];
+#endif // __AVR__
+	// if the instruction register is addressed clear RS
+	if (lcdInstruction)
+		_shadowGPIOB &= ~rsPin;
+}
+
+/*
+ * Helper function to write a byte to the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_lcdWrite8(uint8_t value, bool lcdInstruction) {
+	if (_queue) {
+		_queueWrite8(value, lcdInstruction);
+		return;
+	}
+	_lcdWrite4(value >> 4, lcdInstruction);
+	_lcdWrite4(value, lcdInstruction);
+	_padOwed = _padBytes;
+}
+
+/*
+ * Helper function to calculate the dummy bytes needed for an execution
+ * time of us microseconds. A byte takes 9 clocks and the next instruction
+ * is latched with its second byte.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_padding(uint8_t us) {
+	if (!_busClock)
+		return 0;
+	uint16_t bytes = (us * (_busClock / 1000) + 8999) / 9000;
+	return bytes > 2 ? bytes - 2 : 0;
+}
+
+/*
+ * Helper function to send the dummy bytes still owed to the lcd,
+ * the pins are repeated without a pulse on enable
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_pad() {
+	if (!_padOwed)
+		return;
+	RGBLCD_STAT_WRITE(_padOwed);
+	do
+		Transport::send(_shadowGPIOB);
+	while (--_padOwed);
+}
+
+/*
+ * Helper function to transmit a byte to the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_lcdTransmit(uint8_t value, bool lcdInstruction) {
+	_beginTransmission();
+	_lcdWrite8(value, lcdInstruction);
+	_endTransmission();
+}
+
+/*
+ * Helper function to start a transmission to GPIOB,
+ * does nothing when a batch is open
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_beginTransmission() {
+	if (_queue)
+		return;
+	if (_busy)
+		_waitReady();
+	if (_batchDepth)
+		return;
+	// the stop, start, address and register take about two bytes
+	_padOwed = _padOwed > 2 ? _padOwed - 2 : 0;
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+}
+
+/*
+ * Helper function to queue a byte for the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_queueWrite8(uint8_t value, bool lcdInstruction) {
+	_queueReserve(4 + _padOwed);
+	for (; _padOwed; _padOwed--)
+		_enqueue(_shadowGPIOB);
+	_nibbleToShadow(value >> 4, lcdInstruction);
+	_enqueue(_shadowGPIOB);
+	_shadowGPIOB ^= ePin;
+	_enqueue(_shadowGPIOB);
+	_nibbleToShadow(value, lcdInstruction);
+	_enqueue(_shadowGPIOB);
+	_shadowGPIOB ^= ePin;
+	_enqueue(_shadowGPIOB);
+	_padOwed = _padBytes;
+}
+
+/*
+ * Helper function to add a pin value to the queue
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_enqueue(uint8_t pins) {
+	_queue[_queueTail] = pins;
+	if (++_queueTail == _queueSize)
+		_queueTail = 0;
+	_queueCount++;
+}
+
+/*
+ * Helper function to make room in the queue according to the policy
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_queueReserve(uint8_t bytes) {
+	if (_queueSize - _queueCount >= bytes)
+		return;
+	if (_overflowPolicy == opCoalesce)
+		_flushQueue();
+	else
+		while (_queueSize - _queueCount < bytes && _queueCount)
+			_drainQueue(bytes, true);
+}
+
+/*
+ * Helper function to check if a character must be dropped
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline bool RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_queueDrops() {
+	return _queue && _overflowPolicy == opDrop
+			&& _queueSize - _queueCount < 4 + _padOwed;
+}
+
+/*
+ * Helper function to take the oldest pin value from the queue
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_dequeue() {
+	uint8_t pins = _queue[_queueHead];
+	if (++_queueHead == _queueSize)
+		_queueHead = 0;
+	_queueCount--;
+	return pins;
+}
+
+/*
+ * Helper function to send at most maxBytes of the queue in one transmission.
+ * Stops after a slow instruction, the next call returns immediately
+ * until it is executed unless wait is true. With a budget no byte is
+ * started later than budget microseconds after start.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_drainQueue(uint8_t maxBytes, bool wait,
+		uint32_t start, uint16_t budget) {
+	if (_busy) {
+		if (!wait && !isReady())
+			return;
+		_waitDeadline();
+	}
+	if (!_queueCount)
+		return;
+	if (_queue[_queueHead] == queuePortAMarker) {
+		// a color change, GPIOA has a transmission of its own
+		_dequeue();
+		Transport::write(_address, GPIOA, _dequeue());
+		RGBLCD_STAT_REGISTER();
+		return;
+	}
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+	while (maxBytes-- && _queueCount) {
+		if (_queue[_queueHead] == queuePortAMarker)
+			break;
+		// the pins hold their state, so the stream can stop after any byte
+		if (budget && micros() - start >= budget)
+			break;
+		uint8_t pins = _dequeue();
+		if (pins == queueSlowMarker) {
+			uint8_t ms = _dequeue();
+			// the time counts from when the instruction is on the bus
+			Transport::sync();
+			_readyAt = micros() + ms * 1000UL;
+			_busy = true;
+			break;
+		}
+		Transport::send(pins);
+		RGBLCD_STAT_WRITE(1);
+	}
+	Transport::stop();
+}
+
+/*
+ * Helper function to send the complete queue
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_flushQueue() {
+	if (!_queue)
+		return;
+	while (_queueCount)
+		_drainQueue(0xFF, true);
+}
+
+/*
+ * Helper function to mark the lcd busy for the execution time of
+ * a slow instruction, only blocks in wmDelay mode
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_setBusy(uint8_t ms) {
+	if (_queue) {
+		// the queue waits when it reaches this point
+		_queueReserve(2);
+		_enqueue(queueSlowMarker);
+		_enqueue(ms);
+		return;
+	}
+	// the time counts from when the instruction is on the bus
+	Transport::sync();
+	if (_waitMode == wmDelay) {
+		delay(ms);
+		RGBLCD_STAT_DELAY(ms * 1000UL);
+		return;
+	}
+	_readyAt = micros() + ms * 1000UL;
+	_busy = true;
+}
+
+/*
+ * Helper function to wait until the lcd finished a slow instruction
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_waitReady() {
+	if (_waitMode == wmBusyFlag) {
+		_suspendBatch();
+		_prepareRead(true);
+		// the deadline serves as timeout
+		while ((_lcdRead8() & busyFlag) && (int32_t) (micros() - _readyAt) < 0)
+			;
+		_cleanupRead();
+		_resumeBatch();
+		_busy = false;
+	} else
+		_waitDeadline();
+}
+
+/*
+ * Helper function to wait until the deadline of a slow instruction
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_waitDeadline() {
+	if (!_busy)
+		return;
+	RGBLCD_STAT_WAIT(_readyAt);
+	while ((int32_t) (micros() - _readyAt) < 0)
+		;
+	_busy = false;
+}
+
+/*
+ * Helper function to end a transmission to GPIOB,
+ * does nothing when a batch is open
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_endTransmission() {
+	if (_batchDepth || _queue)
+		return;
+	Transport::stop();
+}
+
+/*
+ * Helper function to close an open batch before accessing
+ * another register
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_suspendBatch() {
+	if (_batchDepth)
+		Transport::stop();
+}
+
+/*
+ * Helper function to reopen a batch after accessing
+ * another register
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_resumeBatch() {
+	if (!_batchDepth)
+		return;
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+}
+
+/*
+ * Helper function to prepare for a read
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_prepareRead(bool lcdInstruction) {
+	// set lcd data pins of GPIOB as input
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(IODIRB);
+	Transport::send(dataPins);
+	RGBLCD_STAT_WRITE(3);
+	// and continue to GPIOB with a repeated start
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	RGBLCD_STAT_WRITE(2);
+	// clear the lcd bits of shadowB
+	_shadowGPIOB &= ~lcdPins;
+	if (lcdInstruction)	// set R/W high
+		_shadowGPIOB |= rwPin;
+	else // set RS, and R/W high
+		_shadowGPIOB |= rsPin | rwPin;
+	Transport::send(_shadowGPIOB);
+	RGBLCD_STAT_WRITE(1);
+}
+
+/*
+ * Helper function to read a nibble from the display
+ * As sequential addressing is disabled the register pointer of the
+ * MCP23017 stays at GPIOB, so the pins are read with a repeated start
+ * without sending the register again. The write that clears enable
+ * stays open so the next nibble only has to send enable high.
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_lcdRead4() {
+	uint8_t value = 0;
+	uint8_t temp;
+	// set enable high
+	_shadowGPIOB |= ePin;
+	Transport::send(_shadowGPIOB);
+	temp = Transport::receive(_address);
+	RGBLCD_STAT_START();
+	RGBLCD_STAT_WRITE(2);
+	RGBLCD_STAT_READ(1);
+	// clear enable
+	_shadowGPIOB &= ~(ePin | dataPins);
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(GPIOB);
+	Transport::send(_shadowGPIOB);
+	RGBLCD_STAT_WRITE(3);
+	// translate pin to nibble
+	bitWrite(value, 0, bitRead(temp, Wiring::db4));
+	bitWrite(value, 1, bitRead(temp, Wiring::db5));
+	bitWrite(value, 2, bitRead(temp, Wiring::db6));
+	bitWrite(value, 3, bitRead(temp, Wiring::db7));
+	return value;
+}
+
+/*
+ * Helper function to read a byte from the display
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline uint8_t RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_lcdRead8() {
+	return (_lcdRead4() << 4) + _lcdRead4();
+}
+
+/*
+ * Helper function to cleanup after read
+ */
+template <class Wiring, class KeyTiming, class Geometry, class Transport>
+inline void RgbLcdKeyShieldI2CT<Wiring, KeyTiming, Geometry, Transport>::_cleanupRead() {
+	// set all pins back as output with a repeated start
+	Transport::start(_address);
+	RGBLCD_STAT_START();
+	Transport::send(IODIRB);
+	Transport::send(B00000000);
+	RGBLCD_STAT_WRITE(3);
+	Transport::stop();
+	// the pins are sent with the next write, R/W must not stay set in the
+	// shadow as the padding and setColor copy it into the queue
+	_shadowGPIOB &= ~(rsPin | rwPin);
+}
+
+#endif //  RgbLcdKeyShieldI2CImpl_H
@@ -0,0 +1,242 @@
+/*
+ * Bus access of the RgbLcdKeyShieldI2C library
+ *
+ * Copyright (C) 2017 Edwin Croissant
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * See the README.md file for additional information.
+ */
+
+#ifndef RgbLcdTransport_H
+#define RgbLcdTransport_H
+
+#include "Arduino.h"
+
+/*
+ * A transport is passed to RgbLcdKeyShieldI2CT as template parameter and
+ * only has static functions, so the calls are inlined:
+ * start     starts a transmission to write, a repeated start when one is open
+ * send      sends a byte in the open transmission
+ * receive   reads a byte with a repeated start
+ * stop      ends the transmission
+ * sync      makes sure what was sent is on the bus, before a delay
+ * write     writes a register in a transmission of its own
+ * read      reads a register in a transmission of its own
+ *
+ * On AVR the I2C library of Wayne Truchsess is used, elsewhere Wire.
+ * Define RGBLCD_WIRE before including the library to use Wire on AVR.
+ */
+
+#if defined(__AVR__) && !defined(RGBLCD_WIRE)
+#include "I2C.h"
+
+/*
+ * The I2C library, every byte goes on the bus when it is sent
+ */
+struct I2CTransport {
+	static inline void start(uint8_t address) {
+		I2c._start();
+		I2c._sendAddress(SLA_W(address));
+	}
+	static inline void send(uint8_t value) {
+		I2c._sendByte(value);
+	}
+	static inline uint8_t receive(uint8_t address) {
+		I2c._start();
+		I2c._sendAddress(SLA_R(address));
+		I2c._receiveByte(0);
+		return TWDR;
+	}
+	static inline void stop() {
+		I2c._stop();
+	}
+	static inline void sync() {
+	}
+	static inline void write(uint8_t address, uint8_t reg, uint8_t value) {
+		I2c.write(address, reg, value);
+	}
+	static inline uint8_t read(uint8_t address, uint8_t reg) {
+		I2c.read(address, reg, 1);
+		return I2c.receive();
+	}
+};
+
+typedef I2CTransport DefaultTransport;
+
+#elif defined(ARDUINO)
+#include "Wire.h"
+
+/*
+ * Wire collects a transmission in a buffer and sends it with
+ * endTransmission. A transmission longer than the buffer is continued
+ * with a repeated start and the register it started with, the MCP23017
+ * doesn't advance the register as sequential addressing is disabled.
+ */
+template <uint8_t bufferLength = 32>
+class WireTransportT {
+public:
+	static void start(uint8_t address) {
+		if (_open)
+			Wire.endTransmission(false);
+		Wire.beginTransmission(address);
+		_address = address;
+		_count = 0;
+		_open = true;
+	}
+	static void send(uint8_t value) {
+		if (_count == bufferLength)
+			_restart();
+		if (!_count)
+			_register = value;
+		Wire.write(value);
+		_count++;
+	}
+	static uint8_t receive(uint8_t address) {
+		if (_open)
+			Wire.endTransmission(false);
+		_open = false;
+		Wire.requestFrom(address, (uint8_t) 1);
+		return Wire.read();
+	}
+	static void stop() {
+		if (_open)
+			Wire.endTransmission();
+		_open = false;
+	}
+	static void sync() {
+		if (_open && _count > 1)
+			_restart();
+	}
+	static void write(uint8_t address, uint8_t reg, uint8_t value) {
+		Wire.beginTransmission(address);
+		Wire.write(reg);
+		Wire.write(value);
+		Wire.endTransmission();
+	}
+	static uint8_t read(uint8_t address, uint8_t reg) {
+		Wire.beginTransmission(address);
+		Wire.write(reg);
+		Wire.endTransmission(false);
+		Wire.requestFrom(address, (uint8_t) 1);
+		return Wire.read();
+	}
+private:
+	// sends the buffer and continues with the same register
+	static void _restart() {
+		Wire.endTransmission(false);
+		Wire.beginTransmission(_address);
+		Wire.write(_register);
+		_count = 1;
+	}
+
+	static bool _open;
+	static uint8_t _address;
+	static uint8_t _register;
+	static uint8_t _count;
+};
+
+template <uint8_t bufferLength>
+bool WireTransportT<bufferLength>::_open = false;
+template <uint8_t bufferLength>
+uint8_t WireTransportT<bufferLength>::_address;
+template <uint8_t bufferLength>
+uint8_t WireTransportT<bufferLength>::_register;
+template <uint8_t bufferLength>
+uint8_t WireTransportT<bufferLength>::_count;
+
+typedef WireTransportT<> WireTransport;
+typedef WireTransport DefaultTransport;
+
+#endif
+
+/*
+ * Records the traffic instead of sending it, to test code on a host.
+ * Reads return the value last written to the register, receive returns
+ * receiveValue.
+ */
+template <uint16_t logSize = 512>
+class MockTransportT {
+public:
+	static void start(uint8_t address) {
+		starts++;
+		_record(address << 1);
+	}
+	static void send(uint8_t value) {
+		_record(value);
+	}
+	static uint8_t receive(uint8_t address) {
+		starts++;
+		_record((address << 1) + 1);
+		return receiveValue;
+	}
+	static void stop() {
+		stops++;
+	}
+	static void sync() {
+	}
+	static void write(uint8_t address, uint8_t reg, uint8_t value) {
+		start(address);
+		send(reg);
+		send(value);
+		stop();
+		registers[reg & 0x1F] = value;
+	}
+	static uint8_t read(uint8_t address, uint8_t reg) {
+		start(address);
+		send(reg);
+		receive(address);
+		stop();
+		return registers[reg & 0x1F];
+	}
+	static void clear() {
+		logLength = 0;
+		starts = 0;
+		stops = 0;
+	}
+
+	// the addresses with the R/W bit and the bytes written, in order
+	static uint8_t log[logSize];
+	static uint16_t logLength;
+	static uint16_t starts;
+	static uint16_t stops;
+	static uint8_t registers[32];
+	static uint8_t receiveValue;
+private:
+	static void _record(uint8_t value) {
+		if (logLength < logSize)
+			log[logLength++] = value;
+	}
+};
+
+template <uint16_t logSize>
+uint8_t MockTransportT<logSize>::log[logSize];
+template <uint16_t logSize>
+uint16_t MockTransportT<logSize>::logLength = 0;
+template <uint16_t logSize>
+uint16_t MockTransportT<logSize>::starts = 0;
+template <uint16_t logSize>
+uint16_t MockTransportT<logSize>::stops = 0;
+template <uint16_t logSize>
+uint8_t MockTransportT<logSize>::registers[32];
+template <uint16_t logSize>
+uint8_t MockTransportT<logSize>::receiveValue = 0;
+
+typedef MockTransportT<> MockTransport;
+
+#if !defined(__AVR__) && !defined(ARDUINO)
+typedef MockTransport DefaultTransport;
+#endif
+
+#endif // RgbLcdTransport_H